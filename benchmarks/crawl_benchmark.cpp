@@ -0,0 +1,335 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "search_engine.h"
+#include "synthetic_server.h"
+
+// Time allowed for the stopped workers to wind down between runs
+static constexpr auto RUN_SETTLE_TIME = 200; // ms
+
+static const std::unordered_map<std::string, LatencyDistribution> gLatencyDistributions
+{
+    {"fixed",       LatencyDistribution::kFixed},
+    {"uniform",     LatencyDistribution::kUniform},
+    {"exponential", LatencyDistribution::kExponential}
+};
+
+struct RunResult
+{
+    ushort  threads_count = 0;
+    quint64 pages = 0;
+    quint64 bytes = 0;
+    quint64 decoded_bytes = 0;
+    double  seconds = 0;
+    double  latency_p50_ms = 0;
+    double  latency_p99_ms = 0;
+    double  first_match_ms = -1;
+    double  peak_rss_mb = 0;
+};
+
+// Starts and final statuses are recorded from the worker threads
+class CrawlRecorder
+{
+public:
+    CrawlRecorder()
+    {
+        timer_.start();
+    }
+
+    void Record(const QString& url, UrlSearchStatus status)
+    {
+        auto now {timer_.nsecsElapsed()};
+        QMutexLocker locker(&mutex_);
+
+        if (status == UrlSearchStatus::kProcess) {
+            started_.insert(url, now);
+            return;
+        }
+
+        auto startedIt {started_.find(url)};
+        if (startedIt != started_.end()) {
+            latencies_.push_back(now - startedIt.value());
+            started_.erase(startedIt);
+        }
+        if (status == UrlSearchStatus::kFound && first_match_ < 0) {
+            first_match_ = now;
+        }
+    }
+
+    double Percentile(double percentile)
+    {
+        QMutexLocker locker(&mutex_);
+
+        if (latencies_.empty()) {
+            return 0;
+        }
+        auto index {static_cast<size_t>(percentile * (latencies_.size() - 1))};
+        std::nth_element(latencies_.begin(), latencies_.begin() + index, latencies_.end());
+        return latencies_[index] / 1e6;
+    }
+
+    quint64 Pages()
+    {
+        QMutexLocker locker(&mutex_);
+        return latencies_.size();
+    }
+
+    double FirstMatchMs()
+    {
+        QMutexLocker locker(&mutex_);
+        return first_match_ < 0 ? -1 : first_match_ / 1e6;
+    }
+
+private:
+    QElapsedTimer           timer_;
+    QMutex                  mutex_;
+    QHash<QString, qint64>  started_ {};
+    std::vector<qint64>     latencies_ {};
+    qint64                  first_match_ = -1;
+};
+
+// Resets the kernel's peak RSS counter so every run reports its own peak
+static void resetPeakRss()
+{
+    QFile clear_refs("/proc/self/clear_refs");
+    if (clear_refs.open(QIODevice::WriteOnly)) {
+        clear_refs.write("5");
+    }
+}
+
+static double peakRssMb()
+{
+    QFile status("/proc/self/status");
+    if (status.open(QIODevice::ReadOnly)) {
+        for (auto& line : status.readAll().split('\n')) {
+            if (line.startsWith("VmHWM:")) {
+                return line.mid(6).trimmed().split(' ').first().toDouble() / 1024;
+            }
+        }
+    }
+
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+static RunResult runCrawl(
+    SyntheticServer& server,
+    const SyntheticSiteConfig& config,
+    ushort threads_count,
+    ushort requests_per_thread,
+    const SearchOptions& options
+)
+{
+    resetPeakRss();
+    server.ResetCounters();
+
+    SearchEngine engine;
+    CrawlRecorder recorder;
+    QEventLoop loop;
+
+    QObject::connect(&engine, &SearchEngine::update_url_status,
+                     [&recorder](const QString& url, UrlSearchStatus status) {
+        recorder.Record(url, status);
+    });
+    QObject::connect(&engine, &SearchEngine::search_result, &loop, [&loop](SearchResult) {
+        loop.quit();
+    });
+
+    QElapsedTimer timer;
+    timer.start();
+
+    engine.Start(server.PageUrl(0),
+                 threads_count,
+                 requests_per_thread,
+                 QStringList {config.target_text},
+                 config.pages_count,
+                 options);
+    loop.exec();
+
+    RunResult result;
+    result.threads_count = threads_count;
+    result.seconds = timer.nsecsElapsed() / 1e9;
+    result.pages = recorder.Pages();
+    result.bytes = server.BytesSent();
+    result.decoded_bytes = engine.GetTransferStats().decoded_bytes;
+    result.latency_p50_ms = recorder.Percentile(0.50);
+    result.latency_p99_ms = recorder.Percentile(0.99);
+    result.first_match_ms = recorder.FirstMatchMs();
+    result.peak_rss_mb = peakRssMb();
+
+    engine.Stop();
+
+    QEventLoop settle;
+    QTimer::singleShot(RUN_SETTLE_TIME, &settle, SLOT(quit()));
+    settle.exec();
+
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("CrawlBenchmark");
+
+    qRegisterMetaType<UrlSearchStatus>("UrlSearchStatus");
+    qRegisterMetaType<SearchResult>("SearchResult");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "End-to-end crawl benchmark against a local synthetic site. Reports "
+        "pages/s, bytes/s, p50/p99 per-url latency, time to first match and "
+        "peak RSS for each thread count. With --target-page and --scent, "
+        "--best-first against the default scheduler compares the time to "
+        "first match of a relevance-ordered crawl with a breadth-first one. "
+        "With --serve it only serves the site, for crawler processes started "
+        "apart, such as the nodes of a cluster.");
+    parser.addHelpOption();
+
+    QCommandLineOption pagesOption("pages", "Pages in the site graph.", "count", "1000");
+    QCommandLineOption degreeOption("out-degree", "Links per page.", "count", "8");
+    QCommandLineOption sizeOption("page-size", "Page body size in bytes.", "bytes", "16384");
+    QCommandLineOption latencyOption("latency", "Latency distribution: fixed, uniform or exponential.", "name", "uniform");
+    QCommandLineOption latencyMeanOption("latency-ms", "Mean response latency.", "ms", "10");
+    QCommandLineOption compressOption("compress", "Serve the pages deflate encoded.");
+    QCommandLineOption hostsOption("hosts", "Loopback hosts serving the site (1..254).", "count", "1");
+    QCommandLineOption errorRateOption("error-rate", "Share of pages answered with HTTP 500.", "rate", "0");
+    QCommandLineOption targetPageOption("target-page", "Page holding the target text, -1 for none.", "page", "-1");
+    QCommandLineOption targetPositionOption("target-position", "Offset of the target text in its page (0..1).", "position", "0.5");
+    QCommandLineOption threadsOption("threads", "Comma separated thread counts.", "list", "1,2,4,8,16,32,64");
+    QCommandLineOption requestsOption("requests", "Concurrent requests per thread.", "count", "1");
+    QCommandLineOption schedulerOption("stealing", "Use the work-stealing scheduler.");
+    QCommandLineOption bestFirstOption("best-first", "Use the best-first scheduler.");
+    QCommandLineOption scentOption("scent", "Name the target's keyword in the anchors of links leading to it.");
+    QCommandLineOption scentNoiseOption("scent-noise", "Share of the other links with the keyword as well.", "rate", "0");
+    QCommandLineOption jsonOption("json", "Print one JSON object per run instead of a table.");
+    QCommandLineOption serveOption("serve", "Print the start url and serve the site until killed, without crawling.");
+
+    parser.addOptions({pagesOption, degreeOption, sizeOption, latencyOption, latencyMeanOption,
+                       hostsOption, compressOption, errorRateOption, targetPageOption, targetPositionOption,
+                       threadsOption, requestsOption, schedulerOption, bestFirstOption,
+                       scentOption, scentNoiseOption, jsonOption, serveOption});
+    parser.process(app);
+
+    SyntheticSiteConfig config;
+    config.pages_count = std::max(parser.value(pagesOption).toInt(), 1);
+    config.out_degree = std::max(parser.value(degreeOption).toInt(), 1);
+    config.page_size = std::max(parser.value(sizeOption).toInt(), 0);
+    config.latency_mean_ms = parser.value(latencyMeanOption).toInt();
+    config.hosts_count = std::min(std::max(parser.value(hostsOption).toInt(), 1), 254);
+    config.compress = parser.isSet(compressOption);
+    config.error_rate = parser.value(errorRateOption).toDouble();
+    config.target_page = parser.value(targetPageOption).toInt();
+    config.target_position = parser.value(targetPositionOption).toDouble();
+    config.scent = parser.isSet(scentOption);
+    config.scent_noise = parser.value(scentNoiseOption).toDouble();
+
+    auto latencyIt {gLatencyDistributions.find(parser.value(latencyOption).toStdString())};
+    if (latencyIt == gLatencyDistributions.end()) {
+        std::fprintf(stderr, "Invalid --latency.\n");
+        return 2;
+    }
+    config.latency = latencyIt->second;
+
+    SearchOptions options;
+    QString scheduler_name {"shared"};
+    if (parser.isSet(schedulerOption)) {
+        options.frontier.scheduler = SchedulerMode::kWorkStealing;
+        scheduler_name = "stealing";
+    }
+    if (parser.isSet(bestFirstOption)) {
+        options.frontier.scheduler = SchedulerMode::kBestFirst;
+        scheduler_name = "best_first";
+    }
+    auto requests_per_thread {std::max<ushort>(parser.value(requestsOption).toUShort(), 1)};
+
+    SyntheticServer server(config);
+    QThread server_thread;
+    server.moveToThread(&server_thread);
+    server_thread.start();
+
+    bool is_listening {false};
+    QMetaObject::invokeMethod(&server, "Listen", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(bool, is_listening));
+    if (!is_listening) {
+        std::fprintf(stderr, "Synthetic server failed to listen.\n");
+        return 1;
+    }
+
+    if (parser.isSet(serveOption)) {
+        auto line {QJsonDocument(QJsonObject {
+            {"event",   "listening"},
+            {"url",     server.PageUrl(0)},
+            {"port",    server.Port()}
+        }).toJson(QJsonDocument::Compact)};
+        std::printf("%s\n", line.constData());
+        std::fflush(stdout);
+
+        auto status {app.exec()};
+        server_thread.quit();
+        server_thread.wait();
+        return status;
+    }
+
+    auto is_json {parser.isSet(jsonOption)};
+    if (!is_json) {
+        std::printf("%8s %8s %10s %10s %9s %9s %14s %12s\n",
+                    "threads", "pages", "pages/s", "MB/s", "p50 ms", "p99 ms", "first match ms", "peak RSS MB");
+    }
+
+    for (const auto& value : parser.value(threadsOption).split(',')) {
+        auto threads_count {value.trimmed().toUShort()};
+        if (threads_count == 0) {
+            continue;
+        }
+
+        auto result {runCrawl(server, config, threads_count, requests_per_thread, options)};
+        auto pages_per_second {result.pages / std::max(result.seconds, 1e-9)};
+        auto mb_per_second {result.bytes / std::max(result.seconds, 1e-9) / (1024 * 1024)};
+
+        if (is_json) {
+            auto line {QJsonDocument(QJsonObject {
+                {"scheduler",           scheduler_name},
+                {"threads",             result.threads_count},
+                {"requests_per_thread", requests_per_thread},
+                {"pages",               static_cast<qint64>(result.pages)},
+                {"seconds",             result.seconds},
+                {"pages_per_second",    pages_per_second},
+                {"bytes_per_second",    result.bytes / std::max(result.seconds, 1e-9)},
+                {"decoded_bytes",       static_cast<qint64>(result.decoded_bytes)},
+                {"latency_p50_ms",      result.latency_p50_ms},
+                {"latency_p99_ms",      result.latency_p99_ms},
+                {"first_match_ms",      result.first_match_ms},
+                {"peak_rss_mb",         result.peak_rss_mb}
+            }).toJson(QJsonDocument::Compact)};
+            std::printf("%s\n", line.constData());
+        }
+        else {
+            std::printf("%8u %8llu %10.1f %10.2f %9.2f %9.2f %14.1f %12.1f\n",
+                        result.threads_count, static_cast<unsigned long long>(result.pages),
+                        pages_per_second, mb_per_second, result.latency_p50_ms, result.latency_p99_ms,
+                        result.first_match_ms, result.peak_rss_mb);
+        }
+        std::fflush(stdout);
+    }
+
+    server_thread.quit();
+    server_thread.wait();
+    return 0;
+}
@@ -0,0 +1,377 @@
+#include <QDir>
+#include <QFile>
+#include <QMutex>
+#include <QRegularExpression>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <queue>
+#include <set>
+#include <vector>
+
+#include "link_extractor.h"
+#include "search_engine.h"
+#include "search_worker.h"
+#include "text_matcher.h"
+#include "url_frontier.h"
+
+// Directory of saved *.html pages, a generated page is used when unset
+static constexpr auto PAGES_DIR_VARIABLE = "WEBCRAWLER_BENCH_PAGES";
+
+static constexpr auto READ_CHUNK_SIZE = 64 * 1024;
+static constexpr auto FRONTIER_MAX_URLS = 99999999u;
+static constexpr auto ABSENT_TERM = "benchmark-absent-term";
+
+static const QUrl gPageUrl {"http://127.0.0.1/page/0"};
+
+static QByteArray GeneratePage()
+{
+    QByteArray page {"<html><head><title>Synthetic page</title>"
+                     "<style>body { margin: 0 }</style></head><body>\n"};
+
+    for (int i = 0; i < 400; ++i) {
+        page += "<p>Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod "
+                "tempor incididunt ut labore et dolore magna aliqua.</p>\n";
+        page += "<a href=\"/page/" + QByteArray::number(i) + "\">relative link</a> ";
+        page += "<a class=\"ext\" href=\"http://www.example.com/path/" + QByteArray::number(i)
+                + "?q=" + QByteArray::number(i * 7) + "\">absolute link</a>\n";
+        if (i % 20 == 0) {
+            page += "<script>var url = \"http://tracker.example.com/\" + " + QByteArray::number(i)
+                    + ";</script>\n";
+        }
+    }
+    page += "</body></html>\n";
+
+    return page;
+}
+
+static const std::vector<QByteArray>& Pages()
+{
+    static const std::vector<QByteArray> pages {[] {
+        std::vector<QByteArray> loaded {};
+
+        QDir dir {qEnvironmentVariable(PAGES_DIR_VARIABLE)};
+        if (!qEnvironmentVariableIsEmpty(PAGES_DIR_VARIABLE)) {
+            for (const auto& name : dir.entryList({"*.html", "*.htm"}, QDir::Files, QDir::Name)) {
+                QFile file {dir.filePath(name)};
+                if (file.open(QIODevice::ReadOnly)) {
+                    loaded.push_back(file.readAll());
+                }
+            }
+        }
+
+        if (loaded.empty()) {
+            loaded.push_back(GeneratePage());
+        }
+
+        return loaded;
+    }()};
+
+    return pages;
+}
+
+static qint64 PagesSize()
+{
+    qint64 size {0};
+    for (const auto& page : Pages()) {
+        size += page.size();
+    }
+
+    return size;
+}
+
+static QStringList Terms(int count)
+{
+    QStringList terms {ABSENT_TERM};
+    for (int i = 1; i < count; ++i) {
+        terms.push_back(QString("absent-term-%1").arg(i));
+    }
+
+    return terms;
+}
+
+// Link extraction
+
+// The regular expression SearchWorker::ParseUrls ran over the decoded page
+static void BM_ParseUrlsRegex(benchmark::State& state)
+{
+    static const QRegularExpression re(
+                "https?:\\/\\/(www\\.)?"\
+                "[-a-zA-Z0-9@:%._\\+~#=]{1,256}"\
+                "\\.[a-zA-Z0-9()]{1,6}\\b([-a-z"\
+                "A-Z0-9()@:%_\\+.~#?&//=]*)", QRegularExpression::CaseInsensitiveOption);
+
+    qint64 links {0};
+    for (auto _ : state) {
+        for (const auto& page : Pages()) {
+            auto it {re.globalMatch(QString::fromUtf8(page))};
+            while (it.hasNext()) {
+                benchmark::DoNotOptimize(it.next().captured(0));
+                ++links;
+            }
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * PagesSize());
+    state.counters["links"] = benchmark::Counter(links, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_ParseUrlsRegex);
+
+static void BM_ParseUrlsExtractor(benchmark::State& state)
+{
+    qint64 links {0};
+    for (auto _ : state) {
+        for (const auto& page : Pages()) {
+            LinkExtractor extractor {gPageUrl};
+            for (qsizetype pos = 0; pos < page.size(); pos += READ_CHUNK_SIZE) {
+                extractor.Feed(page.constData() + pos, std::min<qsizetype>(READ_CHUNK_SIZE, page.size() - pos));
+            }
+            auto found {extractor.TakeLinks()};
+            links += found.size();
+            benchmark::DoNotOptimize(found);
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * PagesSize());
+    state.counters["links"] = benchmark::Counter(links, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_ParseUrlsExtractor);
+
+// Text matching, the terms never occur so every byte is scanned
+
+// What SearchWorker::ProcessReply did: decode the whole body, then search it
+static void BM_MatchQStringContains(benchmark::State& state)
+{
+    auto terms {Terms(state.range(0))};
+
+    for (auto _ : state) {
+        for (const auto& page : Pages()) {
+            auto data {QString::fromUtf8(page)};
+            bool is_found {false};
+            for (const auto& term : terms) {
+                if (data.contains(term)) {
+                    is_found = true;
+                    break;
+                }
+            }
+            benchmark::DoNotOptimize(is_found);
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * PagesSize());
+}
+BENCHMARK(BM_MatchQStringContains)->Arg(1)->Arg(100);
+
+static void BM_MatchTextMatcher(benchmark::State& state)
+{
+    MatchOptions options {};
+    options.case_insensitive = state.range(1) != 0;
+    TextMatcher matcher {Terms(state.range(0)), options};
+
+    for (auto _ : state) {
+        for (const auto& page : Pages()) {
+            TextMatcher::State match_state {};
+            bool is_found {false};
+            for (qsizetype pos = 0; pos < page.size() && !is_found; pos += READ_CHUNK_SIZE) {
+                is_found = matcher.Feed(match_state,
+                                        page.constData() + pos,
+                                        std::min<qsizetype>(READ_CHUNK_SIZE, page.size() - pos));
+            }
+            is_found = is_found || matcher.Finish(match_state);
+            benchmark::DoNotOptimize(is_found);
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * PagesSize());
+}
+BENCHMARK(BM_MatchTextMatcher)->ArgNames({"terms", "icase"})->Args({1, 0})->Args({1, 1})->Args({100, 0});
+
+// Frontier, every iteration admits one new url and takes one url back
+
+// The queue and seen set SearchEngine kept under a single mutex
+class LockedFrontier
+{
+public:
+    void Push(const QString& url)
+    {
+        QMutexLocker locker(&mutex_);
+
+        if (checked_urls_.find(url) == checked_urls_.end() && checked_urls_.size() < FRONTIER_MAX_URLS) {
+            urls_queue_.push(url);
+            checked_urls_.insert(url);
+        }
+    }
+
+    QString Pop()
+    {
+        QMutexLocker locker(&mutex_);
+
+        if (!urls_queue_.empty()) {
+            auto url = urls_queue_.front();
+            urls_queue_.pop();
+            return url;
+        }
+
+        return nullptr;
+    }
+
+private:
+    QMutex              mutex_;
+    std::queue<QString> urls_queue_ {};
+    std::set<QString>   checked_urls_ {};
+};
+
+static std::unique_ptr<LockedFrontier>  gLockedFrontier {};
+static std::unique_ptr<UrlFrontier>     gUrlFrontier {};
+
+static QString BenchmarkUrl(int thread, qint64 i)
+{
+    return QString("http://127.0.0.1/t%1/page/%2").arg(thread).arg(i);
+}
+
+static void BM_FrontierLocked(benchmark::State& state)
+{
+    if (state.thread_index() == 0) {
+        gLockedFrontier.reset(new LockedFrontier());
+    }
+
+    qint64 i {0};
+    for (auto _ : state) {
+        gLockedFrontier->Push(BenchmarkUrl(state.thread_index(), i++));
+        benchmark::DoNotOptimize(gLockedFrontier->Pop());
+    }
+
+    if (state.thread_index() == 0) {
+        gLockedFrontier.reset();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FrontierLocked)->ThreadRange(1, 64)->UseRealTime();
+
+static void BM_UrlFrontier(benchmark::State& state, SchedulerMode scheduler)
+{
+    if (state.thread_index() == 0) {
+        FrontierOptions options {};
+        options.scheduler = scheduler;
+
+        gUrlFrontier.reset(new UrlFrontier());
+        gUrlFrontier->Open(FRONTIER_MAX_URLS, state.threads(), options);
+    }
+
+    qint64 i {0};
+    for (auto _ : state) {
+        gUrlFrontier->Push(BenchmarkUrl(state.thread_index(), i++), state.thread_index());
+        benchmark::DoNotOptimize(gUrlFrontier->Pop(state.thread_index(), false));
+    }
+
+    if (state.thread_index() == 0) {
+        gUrlFrontier->Stop();
+        gUrlFrontier.reset();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_UrlFrontier, shared, SchedulerMode::kSharedQueue)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK_CAPTURE(BM_UrlFrontier, stealing, SchedulerMode::kWorkStealing)->ThreadRange(1, 64)->UseRealTime();
+
+// Status reporting, the path every final worker result takes to the views
+
+static void BM_StatusMapping(benchmark::State& state)
+{
+    std::vector<WorkerResult> results {
+        WorkerResult::kFound,
+        WorkerResult::kNotFound,
+        WorkerResult::kErrorTimeout,
+        WorkerResult::kErrorHostNotFound,
+        WorkerResult::kErrorUnknown
+    };
+
+    size_t i {0};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ToUrlSearchStatus(results[i++ % results.size()]));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StatusMapping);
+
+// Sets up an engine as a running crawl leaves it and reports statuses
+// through the same member its workers call
+class StatusPathBenchmark
+{
+public:
+    StatusPathBenchmark(int threads_count, int workers_count)
+    {
+        engine_.status_ = EngineStatus::kProcess;
+        engine_.frontier_.Open(FRONTIER_MAX_URLS, threads_count, FrontierOptions {});
+        // A url still queued, so no status ends the search
+        engine_.frontier_.Push(BenchmarkUrl(0, -1));
+
+        for (int i = 0; i < workers_count; ++i) {
+            engine_.workers_.push_back(new SearchWorker());
+        }
+
+        QStringList status_names;
+        for (int status = 0; status <= static_cast<int>(UrlSearchStatus::kErrorUnknown); ++status) {
+            status_names.append(ToStatusName(static_cast<UrlSearchStatus>(status)));
+        }
+        metrics_ = std::make_shared<CrawlMetrics>(threads_count, status_names);
+
+        QObject::connect(&engine_, &SearchEngine::update_url_status, [this](const QString&, UrlSearchStatus) {
+            received_.fetch_add(1, std::memory_order_relaxed);
+        });
+    }
+
+    ~StatusPathBenchmark()
+    {
+        for (auto worker : engine_.workers_) {
+            delete worker;
+        }
+        engine_.workers_.clear();
+        engine_.frontier_.Stop();
+    }
+
+    void SetStatus(int thread, const QString& url, WorkerResult status)
+    {
+        engine_.SetWorkerStatus(url, status, metrics_->Shard(thread), nullptr);
+    }
+
+    qint64 Received() const
+    {
+        return received_.load();
+    }
+
+private:
+
+    SearchEngine                    engine_ {};
+    std::shared_ptr<CrawlMetrics>   metrics_ {};
+    std::atomic<qint64>             received_ {0};
+};
+
+static std::unique_ptr<StatusPathBenchmark> gStatusPath {};
+
+// One status per iteration through the engine's own path: the result is
+// counted, the status mutex taken, the signal emitted to one direct
+// receiver and the workers and frontier checked for the end of the search
+static void BM_SetWorkerStatus(benchmark::State& state)
+{
+    if (state.thread_index() == 0) {
+        gStatusPath.reset(new StatusPathBenchmark(state.threads(), state.threads()));
+    }
+
+    QString url {BenchmarkUrl(state.thread_index(), 0)};
+    for (auto _ : state) {
+        gStatusPath->SetStatus(state.thread_index(), url, WorkerResult::kNotFound);
+    }
+
+    if (state.thread_index() == 0) {
+        state.counters["received"] = static_cast<double>(gStatusPath->Received());
+        gStatusPath.reset();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SetWorkerStatus)->ThreadRange(1, 64)->UseRealTime();
+
+BENCHMARK_MAIN();
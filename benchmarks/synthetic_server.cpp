@@ -0,0 +1,275 @@
+#include "synthetic_server.h"
+
+#include <QHostAddress>
+#include <QTimer>
+
+#include <algorithm>
+#include <climits>
+#include <queue>
+
+#include "fingerprint.h"
+
+static const QByteArray PAGE_PATH_PREFIX = "/page/";
+static const QByteArray FILLER_TEXT =
+        "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod "
+        "tempor incididunt ut labore et dolore magna aliqua. ";
+
+SyntheticServer::SyntheticServer(const SyntheticSiteConfig& config) :
+    QObject {nullptr},
+    config_ {config},
+    random_ {config.seed}
+{
+    while (filler_.size() < config_.page_size) {
+        filler_.append(FILLER_TEXT);
+    }
+
+    if (config_.scent && config_.target_page >= 0 && config_.target_page < config_.pages_count) {
+        ComputeTargetDistances();
+    }
+}
+
+quint16 SyntheticServer::Port() const
+{
+    return port_;
+}
+
+QString SyntheticServer::PageUrl(int page) const
+{
+    return QString("http://127.0.0.%1:%2%3%4")
+            .arg(page % std::max(config_.hosts_count, 1) + 1)
+            .arg(Port())
+            .arg(QString::fromLatin1(PAGE_PATH_PREFIX))
+            .arg(page);
+}
+
+quint64 SyntheticServer::BytesSent() const
+{
+    return bytes_sent_;
+}
+
+quint64 SyntheticServer::RequestsServed() const
+{
+    return requests_served_;
+}
+
+void SyntheticServer::ResetCounters()
+{
+    bytes_sent_ = 0;
+    requests_served_ = 0;
+}
+
+bool SyntheticServer::Listen()
+{
+    // The first host picks the port, the others share it
+    quint16 port {0};
+    for (int host = 1; host <= std::max(config_.hosts_count, 1); ++host) {
+        auto server {new QTcpServer(this)};
+        connect(server, &QTcpServer::newConnection, this, [this, server]() {
+            OnNewConnection(server);
+        });
+
+        if (!server->listen(QHostAddress(QString("127.0.0.%1").arg(host)), port)) {
+            return false;
+        }
+
+        port = server->serverPort();
+        servers_.push_back(server);
+    }
+
+    port_ = port;
+    return true;
+}
+
+// Private
+
+void SyntheticServer::OnNewConnection(QTcpServer* server)
+{
+    while (server->hasPendingConnections()) {
+        auto socket {server->nextPendingConnection()};
+
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            OnReadyRead(socket);
+        });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            pending_input_.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void SyntheticServer::OnReadyRead(QTcpSocket* socket)
+{
+    auto& input {pending_input_[socket]};
+    input.append(socket->readAll());
+
+    // Requests carry no body, each one ends with an empty line
+    int end {0};
+    while ((end = input.indexOf("\r\n\r\n")) >= 0) {
+        auto request_line {input.left(input.indexOf("\r\n"))};
+        auto headers {input.left(end).toLower()};
+        auto accepts_deflate {config_.compress && headers.contains("accept-encoding:") && headers.contains("deflate")};
+        input.remove(0, end + 4);
+
+        auto parts {request_line.split(' ')};
+        auto path {parts.size() >= 2 ? parts[1] : QByteArray()};
+
+        QTimer::singleShot(NextLatency(), socket, [this, socket, path, accepts_deflate]() {
+            Respond(socket, path, accepts_deflate);
+        });
+    }
+}
+
+void SyntheticServer::Respond(QTcpSocket* socket, const QByteArray& path, bool accepts_deflate)
+{
+    QByteArray status {"200 OK"};
+    QByteArray body;
+
+    bool is_page_number {false};
+    auto page {path.startsWith(PAGE_PATH_PREFIX)
+                ? path.mid(PAGE_PATH_PREFIX.size()).toInt(&is_page_number)
+                : -1};
+
+    if (!is_page_number || page < 0 || page >= config_.pages_count) {
+        status = "404 Not Found";
+    }
+    else if (IsErrorPage(page)) {
+        status = "500 Internal Server Error";
+    }
+    else {
+        body = BuildPage(page);
+    }
+
+    // qCompress output is a zlib stream behind a 4-byte length
+    auto is_deflated {accepts_deflate && !body.isEmpty()};
+    if (is_deflated) {
+        body = qCompress(body).mid(4);
+    }
+
+    QByteArray response;
+    response.reserve(body.size() + 160);
+    response.append("HTTP/1.1 ").append(status).append("\r\n");
+    response.append("Content-Type: text/html; charset=utf-8\r\n");
+    if (is_deflated) {
+        response.append("Content-Encoding: deflate\r\n");
+    }
+    response.append("Content-Length: ").append(QByteArray::number(body.size())).append("\r\n");
+    response.append("Connection: keep-alive\r\n\r\n");
+    response.append(body);
+
+    socket->write(response);
+    bytes_sent_ += response.size();
+    ++requests_served_;
+}
+
+int SyntheticServer::NextLatency()
+{
+    auto mean {std::max(config_.latency_mean_ms, 0)};
+
+    switch (config_.latency) {
+    case LatencyDistribution::kUniform:
+        return std::uniform_int_distribution<int>(0, 2 * mean)(random_);
+    case LatencyDistribution::kExponential:
+        return mean > 0
+                ? static_cast<int>(std::exponential_distribution<double>(1.0 / mean)(random_))
+                : 0;
+    case LatencyDistribution::kFixed:
+    default:
+        return mean;
+    }
+}
+
+bool SyntheticServer::IsErrorPage(int page) const
+{
+    // Stable across runs so every crawl sees the same failing pages
+    auto hash {Fingerprint64(&page, sizeof(page), config_.seed)};
+    return page != 0 && page != config_.target_page
+            && static_cast<double>(hash % 1000000) < config_.error_rate * 1000000;
+}
+
+QByteArray SyntheticServer::PageHref(int page) const
+{
+    if (config_.hosts_count <= 1) {
+        return PAGE_PATH_PREFIX + QByteArray::number(page);
+    }
+
+    return PageUrl(page).toLatin1();
+}
+
+std::vector<int> SyntheticServer::PageLinks(int page) const
+{
+    std::vector<int> links {(page + 1) % config_.pages_count};
+
+    std::mt19937 page_random {config_.seed ^ static_cast<quint32>(page * 2654435761u)};
+    std::uniform_int_distribution<int> target(0, config_.pages_count - 1);
+    for (int i = 1; i < config_.out_degree; ++i) {
+        links.push_back(target(page_random));
+    }
+    return links;
+}
+
+void SyntheticServer::ComputeTargetDistances()
+{
+    // Breadth-first from the target over the reversed links
+    std::vector<std::vector<int>> linked_from(config_.pages_count);
+    for (int page = 0; page < config_.pages_count; ++page) {
+        for (auto link : PageLinks(page)) {
+            linked_from[link].push_back(page);
+        }
+    }
+
+    target_distances_.assign(config_.pages_count, INT_MAX);
+    target_distances_[config_.target_page] = 0;
+
+    std::queue<int> pages;
+    pages.push(config_.target_page);
+    while (!pages.empty()) {
+        auto page {pages.front()};
+        pages.pop();
+        for (auto source : linked_from[page]) {
+            if (target_distances_[source] == INT_MAX) {
+                target_distances_[source] = target_distances_[page] + 1;
+                pages.push(source);
+            }
+        }
+    }
+}
+
+QByteArray SyntheticServer::AnchorText(int page, int link, int target) const
+{
+    QByteArray text {link == 0 ? "next" : "link"};
+    if (target_distances_.empty()) {
+        return text;
+    }
+
+    auto is_closer {target_distances_[target] < target_distances_[page]};
+    auto key {static_cast<quint64>(page) << 32 | static_cast<quint32>(link)};
+    auto is_decoy {static_cast<double>(Fingerprint64(&key, sizeof(key), config_.seed) % 1000000)
+                   < config_.scent_noise * 1000000};
+    if (is_closer || is_decoy) {
+        text.append(' ').append(config_.scent_text.toUtf8());
+    }
+    return text;
+}
+
+QByteArray SyntheticServer::BuildPage(int page) const
+{
+    QByteArray links;
+    auto targets {PageLinks(page)};
+    for (int i = 0; i < static_cast<int>(targets.size()); ++i) {
+        links.append("<a href=\"").append(PageHref(targets[i])).append("\">")
+             .append(AnchorText(page, i, targets[i])).append("</a>\n");
+    }
+
+    auto text {filler_.left(std::max(config_.page_size - links.size(), 0))};
+    if (page == config_.target_page) {
+        auto position {static_cast<int>(text.size() * std::min(std::max(config_.target_position, 0.0), 1.0))};
+        text.insert(position, config_.target_text.toUtf8());
+    }
+
+    QByteArray body;
+    body.reserve(links.size() + text.size() + 64);
+    body.append("<html><head><title>Page ").append(QByteArray::number(page)).append("</title></head><body>\n");
+    body.append(links);
+    body.append("<p>").append(text).append("</p>\n</body></html>\n");
+    return body;
+}
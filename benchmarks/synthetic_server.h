@@ -0,0 +1,116 @@
+#ifndef SYNTHETICSERVER_H
+#define SYNTHETICSERVER_H
+
+#include <QObject>
+#include <QHash>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#include <atomic>
+#include <random>
+#include <vector>
+
+enum class LatencyDistribution
+{
+    kFixed,
+    kUniform,
+    kExponential
+};
+
+struct SyntheticSiteConfig
+{
+    int     pages_count = 1000;
+    int     out_degree = 8;
+    int     page_size = 16 * 1024;      // bytes
+
+    // Delay before each response: exactly the mean, uniform in
+    // [0, 2 * mean] or exponential with the given mean
+    LatencyDistribution latency = LatencyDistribution::kUniform;
+    int                 latency_mean_ms = 10;
+
+    // Share of pages answered with 500 Internal Server Error
+    double  error_rate = 0.0;
+
+    // Loopback hosts 127.0.0.1 .. 127.0.0.hosts_count serving the pages in
+    // turn, page i lives on host i % hosts_count and links are absolute
+    int     hosts_count = 1;
+
+    // Sends the pages deflate encoded to clients accepting it
+    bool    compress = false;
+
+    // Page holding the target text, -1 for none, and where in the body it sits (0..1)
+    int     target_page = -1;
+    double  target_position = 0.5;
+    QString target_text = "synthetic-target-text";
+
+    // Links leading closer to the target page carry scent_text in their
+    // anchor text, and so do scent_noise of the other links, as decoys
+    bool    scent = false;
+    double  scent_noise = 0.0;
+    QString scent_text = "target";
+
+    quint32 seed = 1;
+};
+
+// Local HTTP/1.1 server generating a deterministic site graph: page i is
+// /page/i, links to page i + 1 and to out_degree - 1 pseudo-random pages,
+// and is padded with filler text up to page_size. Meant to be moved to its
+// own thread so its latency timers never wait on the crawler.
+class SyntheticServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SyntheticServer(const SyntheticSiteConfig& config);
+
+    quint16 Port() const;
+
+    QString PageUrl(int page) const;
+
+    quint64 BytesSent() const;
+
+    quint64 RequestsServed() const;
+
+    void ResetCounters();
+
+public slots:
+    // Listens on a free port of every loopback host, call in the server thread
+    bool Listen();
+
+private:
+
+    SyntheticSiteConfig config_;
+
+    std::vector<QTcpServer*>        servers_ {};
+    QHash<QTcpSocket*, QByteArray>  pending_input_ {};
+    QByteArray                      filler_ {};
+    std::mt19937                    random_;
+    // Links to follow from each page to reach the target, with scent only
+    std::vector<int>                target_distances_ {};
+
+    std::atomic<quint16>    port_ {0};
+    std::atomic<quint64>    bytes_sent_ {0};
+    std::atomic<quint64>    requests_served_ {0};
+
+    void OnNewConnection(QTcpServer* server);
+
+    void OnReadyRead(QTcpSocket* socket);
+
+    void Respond(QTcpSocket* socket, const QByteArray& path, bool accepts_deflate);
+
+    int NextLatency();
+
+    bool IsErrorPage(int page) const;
+
+    QByteArray PageHref(int page) const;
+
+    std::vector<int> PageLinks(int page) const;
+
+    void ComputeTargetDistances();
+
+    QByteArray AnchorText(int page, int link, int target) const;
+
+    QByteArray BuildPage(int page) const;
+};
+
+#endif // SYNTHETICSERVER_H
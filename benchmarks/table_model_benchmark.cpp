@@ -0,0 +1,241 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QHeaderView>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTableView>
+#include <QTableWidget>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "url_table_model.h"
+
+struct StatusEvent
+{
+    int     url;
+    bool    is_final;
+};
+
+struct ReplayResult
+{
+    qint64  events = 0;
+    double  seconds = 0;
+    qint64  flushes = 0;
+    double  max_flush_ms = 0;
+    qint64  rows = 0;
+};
+
+// Every url is reported twice, when its fetch starts and when it ends,
+// with in_flight fetches overlapping like the workers' requests do
+static std::vector<StatusEvent> makeEvents(qint64 events_count, int in_flight)
+{
+    std::vector<StatusEvent> events;
+    events.reserve(events_count);
+
+    auto urls_count {std::max<qint64>(events_count / 2, 1)};
+    for (qint64 url = 0; url < urls_count; ++url) {
+        events.push_back({static_cast<int>(url), false});
+        if (url >= in_flight) {
+            events.push_back({static_cast<int>(url - in_flight), true});
+        }
+    }
+    for (auto url {std::max<qint64>(urls_count - in_flight, 0)}; url < urls_count; ++url) {
+        events.push_back({static_cast<int>(url), true});
+    }
+
+    events.resize(std::min<size_t>(events.size(), events_count));
+    return events;
+}
+
+static QStringList makeUrls(const std::vector<StatusEvent>& events)
+{
+    QStringList urls;
+    for (const auto& event : events) {
+        if (!event.is_final) {
+            urls.append(QString("http://host-%1.test/page/%2").arg(event.url % 64).arg(event.url));
+        }
+    }
+    return urls;
+}
+
+static const QString RESULT_PROCESS     = "Process";
+static const QString RESULT_NOT_FOUND   = "Not Found";
+static const QString RESULT_ERROR       = "Timeout Error";
+
+static ReplayResult replayModel(
+    const std::vector<StatusEvent>& events,
+    const QStringList& urls,
+    int batch_events,
+    int recent_rows
+)
+{
+    UrlTableModel model {recent_rows};
+    QTableView view;
+    view.setModel(&model);
+    view.horizontalHeader()->setSectionResizeMode(UrlTableModel::kColumnUrl, QHeaderView::Stretch);
+    view.resize(800, 600);
+
+    ReplayResult result;
+    QElapsedTimer timer;
+    QElapsedTimer flush_timer;
+    timer.start();
+
+    auto flush = [&]() {
+        flush_timer.start();
+        if (model.Flush() > 0) {
+            view.scrollToBottom();
+        }
+        QCoreApplication::processEvents();
+        result.max_flush_ms = std::max(result.max_flush_ms, flush_timer.nsecsElapsed() / 1e6);
+        ++result.flushes;
+    };
+
+    for (const auto& event : events) {
+        if (event.is_final) {
+            auto is_error {event.url % 50 == 0};
+            model.Update(urls[event.url], Qt::CheckState::Checked,
+                         is_error ? RESULT_ERROR : RESULT_NOT_FOUND,
+                         is_error ? QColor(Qt::red) : QColor(Qt::lightGray),
+                         is_error);
+        }
+        else {
+            model.Update(urls[event.url], Qt::CheckState::PartiallyChecked, RESULT_PROCESS, QColor(Qt::blue));
+        }
+
+        if (++result.events % batch_events == 0) {
+            flush();
+        }
+    }
+    flush();
+
+    result.seconds = timer.nsecsElapsed() / 1e9;
+    result.rows = model.rowCount();
+    return result;
+}
+
+// The table as it was before UrlTableModel: a linear search for the row and
+// three new items per event
+static ReplayResult replayTableWidget(const std::vector<StatusEvent>& events, const QStringList& urls)
+{
+    QTableWidget table;
+    table.setColumnCount(UrlTableModel::kColumnCount);
+    table.horizontalHeader()->setSectionResizeMode(UrlTableModel::kColumnUrl, QHeaderView::Stretch);
+    table.resize(800, 600);
+
+    ReplayResult result;
+    QElapsedTimer timer;
+    timer.start();
+
+    for (const auto& event : events) {
+        const auto& url {urls[event.url]};
+
+        int row {-1};
+        for (int i = 0; i < table.rowCount(); ++i) {
+            if (table.item(i, UrlTableModel::kColumnUrl)->text() == url) {
+                row = i;
+                break;
+            }
+        }
+        if (row < 0) {
+            row = table.rowCount();
+            table.insertRow(row);
+        }
+
+        auto status {new QTableWidgetItem()};
+        status->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
+        status->setCheckState(event.is_final ? Qt::CheckState::Checked : Qt::CheckState::PartiallyChecked);
+
+        auto item {new QTableWidgetItem(event.is_final ? RESULT_NOT_FOUND : RESULT_PROCESS)};
+        item->setForeground(QBrush(event.is_final ? QColor(Qt::lightGray) : QColor(Qt::blue)));
+
+        table.setItem(row, UrlTableModel::kColumnUrl, new QTableWidgetItem(url));
+        table.setItem(row, UrlTableModel::kColumnStatus, status);
+        table.setItem(row, UrlTableModel::kColumnResult, item);
+        table.scrollToBottom();
+        ++result.events;
+    }
+    QCoreApplication::processEvents();
+
+    result.seconds = timer.nsecsElapsed() / 1e9;
+    result.flushes = result.events;
+    result.rows = table.rowCount();
+    return result;
+}
+
+static void printResult(const char* name, const ReplayResult& result, bool is_json)
+{
+    auto events_per_second {result.events / std::max(result.seconds, 1e-9)};
+
+    if (is_json) {
+        auto line {QJsonDocument(QJsonObject {
+            {"table",               name},
+            {"events",              result.events},
+            {"seconds",             result.seconds},
+            {"events_per_second",   events_per_second},
+            {"flushes",             result.flushes},
+            {"max_flush_ms",        result.max_flush_ms},
+            {"rows",                result.rows}
+        }).toJson(QJsonDocument::Compact)};
+        std::printf("%s\n", line.constData());
+    }
+    else {
+        std::printf("%-14s %10lld %10.3f %14.0f %10lld %14.2f %10lld\n",
+                    name, static_cast<long long>(result.events), result.seconds, events_per_second,
+                    static_cast<long long>(result.flushes), result.max_flush_ms,
+                    static_cast<long long>(result.rows));
+    }
+    std::fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    // Runs without a display unless a platform is chosen
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication app(argc, argv);
+    QCoreApplication::setApplicationName("TableModelBenchmark");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Replays url status events into the search window's table model and, "
+        "for comparison, into a QTableWidget updated the way it used to be.");
+    parser.addHelpOption();
+
+    QCommandLineOption eventsOption("events", "Status events replayed into the model.", "count", "1000000");
+    QCommandLineOption inFlightOption("in-flight", "Urls between a start and its final status.", "count", "64");
+    QCommandLineOption batchOption("batch", "Events per flush, about the events of one 33 ms tick.", "count", "2000");
+    QCommandLineOption recentOption("recent-rows", "Finished rows the model keeps besides the errors.", "count", "1000");
+    QCommandLineOption legacyOption("legacy-events", "Status events replayed into the QTableWidget, 0 skips it.", "count", "20000");
+    QCommandLineOption jsonOption("json", "Print one JSON object per table instead of a table.");
+
+    parser.addOptions({eventsOption, inFlightOption, batchOption, recentOption, legacyOption, jsonOption});
+    parser.process(app);
+
+    auto events_count {std::max<qint64>(parser.value(eventsOption).toLongLong(), 1)};
+    auto in_flight {std::max(parser.value(inFlightOption).toInt(), 1)};
+    auto batch_events {std::max(parser.value(batchOption).toInt(), 1)};
+    auto recent_rows {std::max(parser.value(recentOption).toInt(), 0)};
+    auto legacy_events {std::max<qint64>(parser.value(legacyOption).toLongLong(), 0)};
+    auto is_json {parser.isSet(jsonOption)};
+
+    if (!is_json) {
+        std::printf("%-14s %10s %10s %14s %10s %14s %10s\n",
+                    "table", "events", "seconds", "events/s", "flushes", "max flush ms", "rows");
+    }
+
+    auto events {makeEvents(events_count, in_flight)};
+    auto urls {makeUrls(events)};
+    printResult("UrlTableModel", replayModel(events, urls, batch_events, recent_rows), is_json);
+
+    if (legacy_events > 0) {
+        auto legacy {makeEvents(legacy_events, in_flight)};
+        printResult("QTableWidget", replayTableWidget(legacy, makeUrls(legacy)), is_json);
+    }
+
+    return 0;
+}
@@ -0,0 +1,409 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <cstdio>
+#include <unordered_map>
+
+#include "cluster_coordinator.h"
+#include "search_engine.h"
+
+static constexpr auto EXIT_FOUND = 0;
+static constexpr auto EXIT_NOT_FOUND = 1;
+static constexpr auto EXIT_USAGE = 2;
+static constexpr auto EXIT_NODE_LOST = 3;
+
+static const std::unordered_map<std::string, SchedulerMode> gSchedulerModes
+{
+    {"shared",      SchedulerMode::kSharedQueue},
+    {"stealing",    SchedulerMode::kWorkStealing},
+    {"polite",      SchedulerMode::kHostPoliteness},
+    {"best",        SchedulerMode::kBestFirst}
+};
+
+static const std::unordered_map<std::string, CrawlOrder> gCrawlOrders
+{
+    {"bfs", CrawlOrder::kBreadthFirst},
+    {"dfs", CrawlOrder::kDepthFirst}
+};
+
+static const std::unordered_map<std::string, SeenSetMode> gSeenSetModes
+{
+    {"fingerprint", SeenSetMode::kFingerprint},
+    {"bloom",       SeenSetMode::kBloomFilter}
+};
+
+static const std::unordered_map<std::string, QueryRule> gQueryRules
+{
+    {"keep",    QueryRule::kKeep},
+    {"sort",    QueryRule::kSort},
+    {"strip",   QueryRule::kStrip}
+};
+
+static void writeLine(const QJsonObject& object)
+{
+    auto line {QJsonDocument(object).toJson(QJsonDocument::Compact)};
+    line.append('\n');
+    std::fwrite(line.constData(), 1, line.size(), stdout);
+    std::fflush(stdout);
+}
+
+static int usageError(const QString& message)
+{
+    std::fprintf(stderr, "%s\n", qPrintable(message));
+    return EXIT_USAGE;
+}
+
+template <typename T>
+static bool parseChoice(
+    const std::unordered_map<std::string, T>& choices,
+    const QString& value,
+    T& result
+)
+{
+    auto choiceIt {choices.find(value.toStdString())};
+    if (choiceIt == choices.end()) {
+        return false;
+    }
+    result = choiceIt->second;
+    return true;
+}
+
+static const std::unordered_map<ClusterResult, const char*> gClusterResults
+{
+    {ClusterResult::kFound,     "found"},
+    {ClusterResult::kNotFound,  "not_found"},
+    {ClusterResult::kNodeLost,  "node_lost"}
+};
+
+// Joins the nodes and ends their crawl, the nodes are started apart
+static int runCoordinator(QCoreApplication& app, const ClusterOptions& options)
+{
+    ClusterCoordinator coordinator {options};
+
+    QObject::connect(&coordinator, &ClusterCoordinator::node_joined, &app, [](int node) {
+        writeLine({
+            {"event",   "node_joined"},
+            {"node",    node}
+        });
+    });
+
+    QObject::connect(&coordinator, &ClusterCoordinator::finished, &app,
+                     [&coordinator](ClusterResult result, const QString& url) {
+        QJsonArray nodes;
+        for (const auto& status : coordinator.Nodes()) {
+            nodes.append(QJsonObject {
+                {"pages",           static_cast<qint64>(status.pages)},
+                {"forwarded_urls",  static_cast<qint64>(status.forwarded)},
+                {"received_urls",   static_cast<qint64>(status.received)}
+            });
+        }
+
+        writeLine({
+            {"event",   "cluster_result"},
+            {"result",  gClusterResults.at(result)},
+            {"url",     url},
+            {"nodes",   nodes}
+        });
+
+        QCoreApplication::exit(result == ClusterResult::kFound ? EXIT_FOUND
+                               : result == ClusterResult::kNotFound ? EXIT_NOT_FOUND : EXIT_NODE_LOST);
+    });
+
+    if (!coordinator.Start()) {
+        return EXIT_NODE_LOST;
+    }
+    return app.exec();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("WebCrawlerCli");
+
+    qRegisterMetaType<UrlSearchStatus>("UrlSearchStatus");
+    qRegisterMetaType<SearchResult>("SearchResult");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Headless crawler. Streams every url status and the final search "
+        "result to stdout as JSON lines. Exit status is 0 when the text is "
+        "found, 1 when it is not and 2 on invalid arguments. With --cluster, "
+        "--nodes processes started with --node 0 .. nodes - 1 each crawl a "
+        "share of the hosts, and one more started with --coordinator ends "
+        "them all; it exits with 3 when a node is lost.");
+    parser.addHelpOption();
+
+    QCommandLineOption urlOption("url", "Start url.", "url");
+    QCommandLineOption threadsOption("threads", "Worker threads count.", "count", "1");
+    QCommandLineOption requestsOption("requests", "Concurrent requests per thread.", "count", "1");
+    QCommandLineOption searchOption("search", "Text to search, repeat for several terms.", "text");
+    QCommandLineOption maxUrlsOption("max-urls", "Maximum number of urls to check.", "count");
+    QCommandLineOption ignoreCaseOption("ignore-case", "Match ASCII letters case-insensitively.");
+    QCommandLineOption wholeWordOption("whole-word", "Only match terms as whole words.");
+    QCommandLineOption schedulerOption("scheduler", "Url scheduler: shared, stealing, polite or best (best-first by relevance).", "mode", "shared");
+    QCommandLineOption orderOption("order", "Crawl order of the stealing and polite schedulers: bfs or dfs.", "order", "bfs");
+    QCommandLineOption hostRequestsOption("host-requests", "Concurrent requests per host of the polite scheduler.", "count", "2");
+    QCommandLineOption crawlDelayOption("crawl-delay", "Minimum delay between fetches from one host of the polite scheduler.", "ms", "200");
+    QCommandLineOption dnsNegativeTtlOption("dns-negative-ttl", "Time the urls of a host not found fail without a request.", "ms", "30000");
+    QCommandLineOption stateDirOption("state-dir", "Directory persisting the frontier for --resume.", "dir");
+    QCommandLineOption resumeOption("resume", "Continue the crawl persisted in --state-dir.");
+    QCommandLineOption checkpointOption("checkpoint-interval", "Time between frontier checkpoints, 0 for pause and stop only.", "ms", "60000");
+    QCommandLineOption cacheDirOption("cache-dir", "Directory of the response cache, pages are revalidated on re-crawls.", "dir");
+    QCommandLineOption offlineOption("offline", "Serve pages from --cache-dir only.");
+    QCommandLineOption seenSetOption("seen-set", "Seen url set: fingerprint or bloom.", "mode", "fingerprint");
+    QCommandLineOption metricsPortOption("metrics-port", "Local port serving Prometheus metrics at /metrics.", "port");
+    QCommandLineOption metricsFileOption("metrics-file", "File rewritten with a Prometheus metrics snapshot.", "file");
+    QCommandLineOption metricsIntervalOption("metrics-interval", "Time between two --metrics-file snapshots.", "ms", "10000");
+    QCommandLineOption noCanonicalOption("no-canonical", "Dedup urls on their raw spelling instead of their canonical form.");
+    QCommandLineOption queryRuleOption("query", "Query of canonical urls: keep, sort or strip.", "rule", "keep");
+    QCommandLineOption stripParamOption("strip-param", "Query parameter dropped from canonical urls, repeat for several, name* for a prefix.", "name");
+    QCommandLineOption stripWwwOption("strip-www", "Treat www.host and host as one host.");
+    QCommandLineOption stripSlashOption("strip-trailing-slash", "Treat /path/ and /path as one url.");
+    QCommandLineOption contentDedupOption("content-dedup", "Skip the links of pages with the same or nearly the same text as a page crawled before.");
+    QCommandLineOption simhashDistanceOption("simhash-distance", "Bits two page SimHashes may differ by as near duplicates, 0 to 16.", "bits", "3");
+    QCommandLineOption clusterOption("cluster", "Local socket name of the cluster this process joins.", "name");
+    QCommandLineOption nodeOption("node", "Partition of the hosts crawled by this node, 0 to --nodes - 1.", "index", "0");
+    QCommandLineOption nodesOption("nodes", "Nodes of the cluster, --max-urls applies to each.", "count", "1");
+    QCommandLineOption coordinatorOption("coordinator", "Coordinate the --cluster instead of crawling.");
+    QCommandLineOption forwardBatchOption("forward-batch", "Urls of another node sent in one message.", "count", "256");
+    QCommandLineOption forwardIntervalOption("forward-interval", "Longest wait of a url for its batch to fill.", "ms", "50");
+    QCommandLineOption traceFileOption("trace-file", "Chrome trace of the worker threads written when the crawl ends.", "file");
+    QCommandLineOption traceEventsOption("trace-events", "Newest spans kept per thread in --trace-file.", "count", "65536");
+    QCommandLineOption bloomRateOption("bloom-fp-rate", "False positive rate of the bloom seen set.", "rate", "0.001");
+
+    parser.addOptions({urlOption, threadsOption, requestsOption, searchOption, maxUrlsOption,
+                       ignoreCaseOption, wholeWordOption, schedulerOption, orderOption,
+                       hostRequestsOption, crawlDelayOption,
+                       dnsNegativeTtlOption, stateDirOption, resumeOption, checkpointOption,
+                       cacheDirOption, offlineOption, seenSetOption, bloomRateOption,
+                       metricsPortOption, metricsFileOption, metricsIntervalOption,
+                       traceFileOption, traceEventsOption, noCanonicalOption, queryRuleOption,
+                       stripParamOption, stripWwwOption, stripSlashOption, contentDedupOption,
+                       simhashDistanceOption, clusterOption, nodeOption, nodesOption,
+                       coordinatorOption, forwardBatchOption, forwardIntervalOption});
+    parser.process(app);
+
+    bool is_valid {false};
+    ClusterOptions cluster;
+    cluster.name = parser.value(clusterOption);
+    cluster.nodes = parser.value(nodesOption).toInt(&is_valid);
+    if (!is_valid || (!cluster.name.isEmpty() && cluster.nodes < 2)) {
+        return usageError("Invalid --nodes, a cluster has 2 nodes or more.");
+    }
+    cluster.node = parser.value(nodeOption).toInt(&is_valid);
+    if (!is_valid || cluster.node < 0 || cluster.node >= cluster.nodes) {
+        return usageError("Invalid --node.");
+    }
+    cluster.batch_size = parser.value(forwardBatchOption).toInt(&is_valid);
+    if (!is_valid || cluster.batch_size <= 0) {
+        return usageError("Invalid --forward-batch.");
+    }
+    cluster.flush_interval = parser.value(forwardIntervalOption).toInt(&is_valid);
+    if (!is_valid || cluster.flush_interval <= 0) {
+        return usageError("Invalid --forward-interval.");
+    }
+    if (parser.isSet(coordinatorOption)) {
+        if (cluster.name.isEmpty()) {
+            return usageError("--coordinator needs --cluster.");
+        }
+        return runCoordinator(app, cluster);
+    }
+
+    auto start_url {parser.value(urlOption)};
+    if (start_url.isEmpty()) {
+        return usageError("Missing --url.");
+    }
+
+    auto threads_count {parser.value(threadsOption).toUShort(&is_valid)};
+    if (!is_valid || threads_count == 0) {
+        return usageError("Invalid --threads.");
+    }
+
+    auto requests_count {parser.value(requestsOption).toUShort(&is_valid)};
+    if (!is_valid || requests_count == 0) {
+        return usageError("Invalid --requests.");
+    }
+
+    auto search_terms {parser.values(searchOption)};
+    if (search_terms.isEmpty()) {
+        return usageError("Missing --search.");
+    }
+
+    auto max_urls {parser.value(maxUrlsOption).toUInt(&is_valid)};
+    if (!is_valid || max_urls == 0) {
+        return usageError("Missing or invalid --max-urls.");
+    }
+
+    SearchOptions options;
+    options.match.case_insensitive = parser.isSet(ignoreCaseOption);
+    options.match.whole_word = parser.isSet(wholeWordOption);
+
+    if (!parseChoice(gSchedulerModes, parser.value(schedulerOption), options.frontier.scheduler)) {
+        return usageError("Invalid --scheduler.");
+    }
+    if (!parseChoice(gCrawlOrders, parser.value(orderOption), options.frontier.crawl_order)) {
+        return usageError("Invalid --order.");
+    }
+    options.frontier.politeness.max_requests_per_host = parser.value(hostRequestsOption).toUShort(&is_valid);
+    if (!is_valid || options.frontier.politeness.max_requests_per_host == 0) {
+        return usageError("Invalid --host-requests.");
+    }
+    options.frontier.politeness.crawl_delay = parser.value(crawlDelayOption).toInt(&is_valid);
+    if (!is_valid || options.frontier.politeness.crawl_delay < 0) {
+        return usageError("Invalid --crawl-delay.");
+    }
+    options.resolver.negative_ttl = parser.value(dnsNegativeTtlOption).toInt(&is_valid);
+    if (!is_valid || options.resolver.negative_ttl < 0) {
+        return usageError("Invalid --dns-negative-ttl.");
+    }
+    if (!parseChoice(gSeenSetModes, parser.value(seenSetOption), options.frontier.seen_set)) {
+        return usageError("Invalid --seen-set.");
+    }
+    options.frontier.bloom_false_positive_rate = parser.value(bloomRateOption).toDouble(&is_valid);
+    if (!is_valid) {
+        return usageError("Invalid --bloom-fp-rate.");
+    }
+    options.frontier.canonical.enabled = !parser.isSet(noCanonicalOption);
+    if (!parseChoice(gQueryRules, parser.value(queryRuleOption), options.frontier.canonical.query)) {
+        return usageError("Invalid --query.");
+    }
+    options.frontier.canonical.strip_params = parser.values(stripParamOption);
+    options.frontier.canonical.strip_www = parser.isSet(stripWwwOption);
+    options.frontier.canonical.strip_trailing_slash = parser.isSet(stripSlashOption);
+    options.content.enabled = parser.isSet(contentDedupOption);
+    options.content.max_distance = parser.value(simhashDistanceOption).toInt(&is_valid);
+    if (!is_valid || options.content.max_distance < 0 || options.content.max_distance > 16) {
+        return usageError("Invalid --simhash-distance.");
+    }
+    options.frontier.state_dir = parser.value(stateDirOption);
+    options.frontier.resume = parser.isSet(resumeOption);
+    if (options.frontier.resume && options.frontier.state_dir.isEmpty()) {
+        return usageError("--resume needs --state-dir.");
+    }
+    options.frontier.checkpoint_interval = parser.value(checkpointOption).toInt(&is_valid);
+    if (!is_valid || options.frontier.checkpoint_interval < 0) {
+        return usageError("Invalid --checkpoint-interval.");
+    }
+    options.cache.dir = parser.value(cacheDirOption);
+    options.cache.offline = parser.isSet(offlineOption);
+    if (options.cache.offline && options.cache.dir.isEmpty()) {
+        return usageError("--offline needs --cache-dir.");
+    }
+    if (parser.isSet(metricsPortOption)) {
+        options.metrics.port = parser.value(metricsPortOption).toUShort(&is_valid);
+        if (!is_valid || options.metrics.port == 0) {
+            return usageError("Invalid --metrics-port.");
+        }
+    }
+    options.metrics.file = parser.value(metricsFileOption);
+    options.metrics.interval = parser.value(metricsIntervalOption).toInt(&is_valid);
+    if (!is_valid || options.metrics.interval <= 0) {
+        return usageError("Invalid --metrics-interval.");
+    }
+    options.cluster = cluster;
+    options.trace.file = parser.value(traceFileOption);
+    options.trace.events_per_thread = parser.value(traceEventsOption).toInt(&is_valid);
+    if (!is_valid || options.trace.events_per_thread <= 0) {
+        return usageError("Invalid --trace-events.");
+    }
+
+    SearchEngine engine;
+    QElapsedTimer elapsed;
+    bool is_finished {false};
+
+    // Engine signals come from the worker threads, the app context
+    // queues them so lines are written from the main thread only
+    QObject::connect(&engine, &SearchEngine::update_url_status, &app,
+                     [&](const QString& url, UrlSearchStatus status) {
+        if (is_finished) {
+            return;
+        }
+
+        writeLine({
+            {"event",       "url_status"},
+            {"url",         url},
+            {"status",      ToStatusName(status)},
+            {"elapsed_ms",  elapsed.elapsed()}
+        });
+    });
+
+    QObject::connect(&engine, &SearchEngine::search_result, &app,
+                     [&](SearchResult result) {
+        if (is_finished) {
+            return;
+        }
+        is_finished = true;
+
+        engine.Stop();
+
+        auto is_found {result == SearchResult::kFound};
+        auto dns {engine.GetResolverStats()};
+        auto cache {engine.GetCacheStats()};
+        auto transfer {engine.GetTransferStats()};
+        auto canonical {engine.GetCanonicalStats()};
+        auto content {engine.GetContentStats()};
+
+        QJsonObject stages;
+        auto metrics {engine.GetMetrics()};
+        for (int stage = 0; stage < METRIC_STAGE_COUNT; ++stage) {
+            const auto& histogram {metrics.stages[stage]};
+            stages.insert(CrawlMetrics::StageName(static_cast<MetricStage>(stage)), QJsonObject {
+                {"count",   static_cast<qint64>(histogram.count)},
+                {"p50_ms",  histogram.Percentile(0.50) / 1e6},
+                {"p99_ms",  histogram.Percentile(0.99) / 1e6}
+            });
+        }
+
+        QJsonObject line {
+            {"event",       "search_result"},
+            {"result",      is_found ? "found" : "not_found"},
+            {"elapsed_ms",  elapsed.elapsed()},
+            {"dns", QJsonObject {
+                {"lookups",             static_cast<qint64>(dns.lookups)},
+                {"negative_hits",       static_cast<qint64>(dns.negative_hits)},
+                {"negative_hit_rate",   dns.NegativeHitRate()}
+            }},
+            {"cache", QJsonObject {
+                {"hits",            static_cast<qint64>(cache.hits)},
+                {"misses",          static_cast<qint64>(cache.misses)},
+                {"revalidations",   static_cast<qint64>(cache.revalidations)}
+            }},
+            {"transfer", QJsonObject {
+                {"received_bytes",      static_cast<qint64>(transfer.received_bytes)},
+                {"decoded_bytes",       static_cast<qint64>(transfer.decoded_bytes)},
+                {"compression_ratio",   transfer.CompressionRatio()}
+            }},
+            {"canonical", QJsonObject {
+                {"rewritten",           static_cast<qint64>(canonical.rewritten)},
+                {"duplicates_avoided",  static_cast<qint64>(canonical.duplicates)}
+            }},
+            {"content", QJsonObject {
+                {"pages",               static_cast<qint64>(content.pages)},
+                {"duplicates",          static_cast<qint64>(content.duplicates)},
+                {"near_duplicates",     static_cast<qint64>(content.near_duplicates)}
+            }},
+            {"stages",      stages}
+        };
+        if (!options.cluster.name.isEmpty()) {
+            auto cluster_stats {engine.GetClusterStats()};
+            line.insert("cluster", QJsonObject {
+                {"node",            options.cluster.node},
+                {"forwarded_urls",  static_cast<qint64>(cluster_stats.forwarded)},
+                {"suppressed_urls", static_cast<qint64>(cluster_stats.suppressed)},
+                {"received_urls",   static_cast<qint64>(cluster_stats.received)}
+            });
+        }
+        writeLine(line);
+
+        QCoreApplication::exit(is_found ? EXIT_FOUND : EXIT_NOT_FOUND);
+    });
+
+    elapsed.start();
+    engine.Start(start_url, threads_count, requests_count, search_terms, max_urls, options);
+
+    return app.exec();
+}
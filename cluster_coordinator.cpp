@@ -0,0 +1,236 @@
+#include "cluster_coordinator.h"
+
+#include <QDebug>
+
+#include <algorithm>
+
+// Time allowed for every node to join once the coordinator listens
+static constexpr auto JOIN_TIMEOUT = 60000; // ms
+
+static bool isSameStatus(const NodeStatus& first, const NodeStatus& second)
+{
+    return first.is_idle == second.is_idle
+        && first.forwarded == second.forwarded
+        && first.received == second.received
+        && first.pages == second.pages;
+}
+
+ClusterCoordinator::ClusterCoordinator(const ClusterOptions& options) :
+    QObject {nullptr},
+    options_ {options},
+    nodes_(std::max(options.nodes, 1), nullptr),
+    statuses_(nodes_.size())
+{
+    probe_timer_.setSingleShot(true);
+    join_timer_.setSingleShot(true);
+
+    connect(&server_, &QLocalServer::newConnection, this, [this]() {
+        OnNewConnection();
+    });
+    connect(&probe_timer_, &QTimer::timeout, this, [this]() {
+        Probe();
+    });
+    connect(&join_timer_, &QTimer::timeout, this, [this]() {
+        qWarning() << "Cluster: not every node joined" << options_.name;
+        Finish(ClusterResult::kNodeLost, QString());
+    });
+}
+
+bool ClusterCoordinator::Start()
+{
+    // A coordinator killed before it closed its server leaves the socket file behind
+    QLocalServer::removeServer(options_.name);
+    if (!server_.listen(options_.name)) {
+        qWarning() << "Cluster: cannot listen on" << options_.name << server_.errorString();
+        return false;
+    }
+
+    join_timer_.start(JOIN_TIMEOUT);
+    return true;
+}
+
+const std::vector<NodeStatus>& ClusterCoordinator::Nodes() const
+{
+    return statuses_;
+}
+
+// Private
+
+void ClusterCoordinator::OnNewConnection()
+{
+    while (server_.hasPendingConnections()) {
+        auto socket {server_.nextPendingConnection()};
+
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+            OnReadyRead(socket);
+        });
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+            OnDisconnected(socket);
+        });
+    }
+}
+
+void ClusterCoordinator::OnReadyRead(QLocalSocket* socket)
+{
+    // Taken out of the map, a refused node is disconnected while its messages are read
+    auto input {pending_input_.take(socket)};
+    input.append(socket->readAll());
+
+    ClusterMessage type;
+    QByteArray payload;
+    while (TakeClusterMessage(input, type, payload)) {
+        OnMessage(socket, type, payload);
+    }
+
+    if (socket->state() == QLocalSocket::ConnectedState) {
+        pending_input_.insert(socket, input);
+    }
+}
+
+void ClusterCoordinator::OnDisconnected(QLocalSocket* socket)
+{
+    auto node {NodeOf(socket)};
+    if (node >= 0) {
+        nodes_[node] = nullptr;
+    }
+    pending_input_.remove(socket);
+    socket->deleteLater();
+
+    // Nothing would crawl the partition of the node any more
+    if (node >= 0 && !is_finished_) {
+        qWarning() << "Cluster: node" << node << "left before the end";
+        Finish(ClusterResult::kNodeLost, QString());
+    }
+}
+
+void ClusterCoordinator::OnMessage(QLocalSocket* socket, ClusterMessage type, const QByteArray& payload)
+{
+    QDataStream stream {payload};
+    stream.setVersion(CLUSTER_STREAM_VERSION);
+
+    switch (type) {
+    case ClusterMessage::kHello: {
+        qint32 node {-1};
+        qint32 nodes {0};
+        stream >> node >> nodes;
+        Join(socket, node, nodes);
+        break;
+    }
+    case ClusterMessage::kStatus: {
+        auto node {NodeOf(socket)};
+        quint32 wave {0};
+        NodeStatus status;
+        status.is_joined = true;
+        stream >> wave >> status.is_idle >> status.forwarded >> status.received >> status.pages;
+        if (node < 0 || wave != wave_ || stream.status() != QDataStream::Ok) {
+            break;
+        }
+
+        statuses_[node] = status;
+        if (++replies_ == static_cast<int>(nodes_.size())) {
+            EndWave();
+        }
+        break;
+    }
+    case ClusterMessage::kFound: {
+        QString url;
+        stream >> url;
+        Finish(ClusterResult::kFound, url);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void ClusterCoordinator::Join(QLocalSocket* socket, int node, int nodes)
+{
+    if (is_finished_ || nodes != static_cast<int>(nodes_.size())
+        || node < 0 || node >= nodes || nodes_[node] != nullptr) {
+        qWarning() << "Cluster: refused node" << node << "of" << nodes;
+        socket->disconnectFromServer();
+        return;
+    }
+
+    nodes_[node] = socket;
+    statuses_[node].is_joined = true;
+    emit node_joined(node);
+
+    auto is_complete {std::all_of(nodes_.begin(), nodes_.end(), [](auto joined) {
+        return joined != nullptr;
+    })};
+    if (is_complete) {
+        join_timer_.stop();
+        probe_timer_.start(std::max(options_.probe_interval, 1));
+    }
+}
+
+void ClusterCoordinator::Probe()
+{
+    ++wave_;
+    replies_ = 0;
+
+    QByteArray payload;
+    QDataStream stream {&payload, QIODevice::WriteOnly};
+    stream.setVersion(CLUSTER_STREAM_VERSION);
+    stream << wave_;
+
+    for (auto socket : nodes_) {
+        if (socket) {
+            WriteClusterMessage(socket, ClusterMessage::kProbe, payload);
+        }
+    }
+}
+
+void ClusterCoordinator::EndWave()
+{
+    quint64 forwarded {0};
+    quint64 received {0};
+    bool is_idle {true};
+    for (const auto& status : statuses_) {
+        forwarded += status.forwarded;
+        received += status.received;
+        is_idle = is_idle && status.is_idle;
+    }
+
+    auto is_unchanged {has_previous_ && std::equal(statuses_.begin(), statuses_.end(),
+                                                   previous_.begin(), isSameStatus)};
+    if (is_idle && forwarded == received && is_unchanged) {
+        Finish(ClusterResult::kNotFound, QString());
+        return;
+    }
+
+    previous_ = statuses_;
+    has_previous_ = true;
+    probe_timer_.start(std::max(options_.probe_interval, 1));
+}
+
+void ClusterCoordinator::Finish(ClusterResult result, const QString& url)
+{
+    if (is_finished_) {
+        return;
+    }
+    is_finished_ = true;
+    probe_timer_.stop();
+    join_timer_.stop();
+
+    QByteArray payload;
+    QDataStream stream {&payload, QIODevice::WriteOnly};
+    stream.setVersion(CLUSTER_STREAM_VERSION);
+    stream << (result == ClusterResult::kFound) << url;
+
+    for (auto socket : nodes_) {
+        if (socket) {
+            WriteClusterMessage(socket, ClusterMessage::kStop, payload);
+            socket->flush();
+        }
+    }
+
+    emit finished(result, url);
+}
+
+int ClusterCoordinator::NodeOf(QLocalSocket* socket) const
+{
+    auto nodeIt {std::find(nodes_.begin(), nodes_.end(), socket)};
+    return nodeIt == nodes_.end() ? -1 : static_cast<int>(nodeIt - nodes_.begin());
+}
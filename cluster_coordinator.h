@@ -0,0 +1,90 @@
+#ifndef CLUSTERCOORDINATOR_H
+#define CLUSTERCOORDINATOR_H
+
+#include <QObject>
+#include <QHash>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTimer>
+
+#include <vector>
+
+#include "cluster_protocol.h"
+
+enum class ClusterResult
+{
+    kFound,
+    kNotFound,
+    // A node never joined or left before the end, its partition is lost
+    kNodeLost
+};
+
+struct NodeStatus
+{
+    bool    is_joined = false;
+    bool    is_idle = false;
+    quint64 forwarded = 0;
+    quint64 received = 0;
+    quint64 pages = 0;
+};
+
+// Joins the nodes of a cluster and ends their crawl. The first found url
+// ends it at once. Otherwise the nodes are probed in waves, and the crawl
+// is over after two waves in a row where every node was idle, every url
+// forwarded had been received and no counter moved between the waves:
+// a url still in flight, or a node woken up by one, shows in the counters.
+class ClusterCoordinator : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ClusterCoordinator(const ClusterOptions& options);
+
+    bool Start();
+
+    // Last reported status of every node
+    const std::vector<NodeStatus>& Nodes() const;
+
+signals:
+    void node_joined(int node);
+
+    void finished(ClusterResult result, const QString& url);
+
+private:
+
+    ClusterOptions  options_;
+    QLocalServer    server_ {};
+    QTimer          probe_timer_ {};
+    QTimer          join_timer_ {};
+    bool            is_finished_ = false;
+
+    std::vector<QLocalSocket*>          nodes_ {};
+    std::vector<NodeStatus>             statuses_ {};
+    QHash<QLocalSocket*, QByteArray>    pending_input_ {};
+
+    quint32                     wave_ = 0;
+    int                         replies_ = 0;
+    // The wave before, to tell whether anything moved since
+    std::vector<NodeStatus>     previous_ {};
+    bool                        has_previous_ = false;
+
+    void OnNewConnection();
+
+    void OnReadyRead(QLocalSocket* socket);
+
+    void OnDisconnected(QLocalSocket* socket);
+
+    void OnMessage(QLocalSocket* socket, ClusterMessage type, const QByteArray& payload);
+
+    void Join(QLocalSocket* socket, int node, int nodes);
+
+    void Probe();
+
+    void EndWave();
+
+    void Finish(ClusterResult result, const QString& url);
+
+    int NodeOf(QLocalSocket* socket) const;
+};
+
+#endif // CLUSTERCOORDINATOR_H
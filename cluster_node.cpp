@@ -0,0 +1,325 @@
+#include "cluster_node.h"
+
+#include <QDebug>
+
+#include <algorithm>
+
+// Time allowed to reach the coordinator, it may be started after the nodes
+static constexpr auto CONNECT_TIMEOUT = 30000; // ms
+static constexpr auto CLOSE_TIMEOUT = 1000; // ms
+
+ClusterNode::ClusterNode(
+    const ClusterOptions& options,
+    std::function<void(const QString&, const UrlHint&)> PushUrl,
+    std::function<bool()>                               IsIdle,
+    std::function<quint64()>                            CountPages,
+    std::function<void(bool)>                           Stop
+) : QObject {nullptr},
+    options_ {options},
+    pending_urls_(std::max(options.nodes, 1)),
+    PushUrl_ {PushUrl},
+    IsIdle_ {IsIdle},
+    CountPages_ {CountPages},
+    Stop_ {Stop}
+{
+    peers_.resize(pending_urls_.size(), nullptr);
+
+    connect(&server_, &QLocalServer::newConnection, this, [this]() {
+        OnNewConnection();
+    });
+    connect(&flush_timer_, &QTimer::timeout, this, [this]() {
+        Flush();
+    });
+}
+
+ClusterNode::~ClusterNode()
+{
+    Close();
+}
+
+bool ClusterNode::Start()
+{
+    auto name {NodeSocketName(options_.name, options_.node)};
+
+    // A node killed before it closed its server leaves the socket file behind
+    QLocalServer::removeServer(name);
+    if (!server_.listen(name)) {
+        qWarning() << "Cluster: cannot listen on" << name << server_.errorString();
+        return false;
+    }
+
+    coordinator_ = new QLocalSocket(this);
+    connect(coordinator_, &QLocalSocket::connected, this, [this]() {
+        is_joined_ = true;
+
+        QByteArray payload;
+        QDataStream stream {&payload, QIODevice::WriteOnly};
+        stream.setVersion(CLUSTER_STREAM_VERSION);
+        stream << static_cast<qint32>(options_.node) << static_cast<qint32>(options_.nodes);
+        WriteClusterMessage(coordinator_, ClusterMessage::kHello, payload);
+    });
+    connect(coordinator_, &QLocalSocket::readyRead, this, [this]() {
+        OnReadyRead(coordinator_);
+    });
+    connect(coordinator_, &QLocalSocket::disconnected, this, [this]() {
+        // Nothing could end the crawl any more
+        if (!is_stopped_) {
+            qWarning() << "Cluster: lost the coordinator" << options_.name;
+            StopCrawl(false);
+        }
+    });
+
+    connect_timer_.start();
+    ConnectCoordinator();
+
+    flush_timer_.start(std::max(options_.flush_interval, 1));
+    return true;
+}
+
+void ClusterNode::Close()
+{
+    {
+        QMutexLocker locker(&mutex_);
+        if (is_closed_) {
+            return;
+        }
+        is_closed_ = true;
+    }
+
+    is_stopped_ = true;
+    flush_timer_.stop();
+    server_.close();
+
+    // A found url reported just before must still reach the coordinator
+    if (coordinator_ && coordinator_->state() == QLocalSocket::ConnectedState) {
+        coordinator_->waitForBytesWritten(CLOSE_TIMEOUT);
+        coordinator_->disconnectFromServer();
+    }
+    for (auto peer : peers_) {
+        if (peer && peer->state() == QLocalSocket::ConnectedState) {
+            peer->disconnectFromServer();
+        }
+    }
+}
+
+void ClusterNode::Forward(int node, const QString& url, const UrlHint& hint)
+{
+    QMutexLocker locker(&mutex_);
+
+    if (is_closed_ || node < 0 || node >= static_cast<int>(pending_urls_.size())) {
+        return;
+    }
+
+    auto& batch {pending_urls_[node]};
+    batch.push_back(ForwardedUrl {url, hint});
+
+    // A full batch goes out without waiting for the timer
+    if (static_cast<int>(batch.size()) >= options_.batch_size && !is_flush_queued_) {
+        is_flush_queued_ = true;
+        QMetaObject::invokeMethod(this, "Flush", Qt::QueuedConnection);
+    }
+}
+
+void ClusterNode::ReportFound(const QString& url)
+{
+    QMetaObject::invokeMethod(this, "SendFound", Qt::QueuedConnection, Q_ARG(QString, url));
+}
+
+ClusterStats ClusterNode::Stats() const
+{
+    ClusterStats stats;
+    stats.forwarded = forwarded_urls_;
+    stats.received = received_urls_;
+    return stats;
+}
+
+// Private slots
+
+void ClusterNode::Flush()
+{
+    if (!is_joined_ && !is_stopped_ && coordinator_ && coordinator_->state() == QLocalSocket::UnconnectedState) {
+        if (connect_timer_.elapsed() < CONNECT_TIMEOUT) {
+            ConnectCoordinator();
+        }
+        else {
+            qWarning() << "Cluster: cannot reach the coordinator" << options_.name;
+            StopCrawl(false);
+        }
+    }
+
+    {
+        QMutexLocker locker(&mutex_);
+        is_flush_queued_ = false;
+    }
+
+    for (int node = 0; node < static_cast<int>(pending_urls_.size()); ++node) {
+        std::vector<ForwardedUrl> batch;
+        {
+            QMutexLocker locker(&mutex_);
+            if (is_closed_ || pending_urls_[node].empty()) {
+                continue;
+            }
+        }
+
+        // Kept for the next tick until the node listens, it may start after this one
+        auto peer {Peer(node)};
+        if (peer->state() != QLocalSocket::ConnectedState) {
+            continue;
+        }
+
+        {
+            QMutexLocker locker(&mutex_);
+            batch.swap(pending_urls_[node]);
+        }
+
+        QByteArray payload;
+        QDataStream stream {&payload, QIODevice::WriteOnly};
+        stream.setVersion(CLUSTER_STREAM_VERSION);
+        stream << static_cast<quint32>(batch.size());
+        for (const auto& forwarded : batch) {
+            stream << forwarded.url << forwarded.hint.relevance << forwarded.hint.parent;
+        }
+        WriteClusterMessage(peer, ClusterMessage::kUrls, payload);
+
+        forwarded_urls_ += batch.size();
+    }
+}
+
+void ClusterNode::SendFound(const QString& url)
+{
+    if (!coordinator_ || coordinator_->state() != QLocalSocket::ConnectedState) {
+        return;
+    }
+
+    QByteArray payload;
+    QDataStream stream {&payload, QIODevice::WriteOnly};
+    stream.setVersion(CLUSTER_STREAM_VERSION);
+    stream << url;
+    WriteClusterMessage(coordinator_, ClusterMessage::kFound, payload);
+    coordinator_->flush();
+}
+
+// Private
+
+void ClusterNode::ConnectCoordinator()
+{
+    coordinator_->connectToServer(options_.name);
+}
+
+void ClusterNode::StopCrawl(bool is_found)
+{
+    if (is_stopped_) {
+        return;
+    }
+    is_stopped_ = true;
+    Stop_(is_found);
+}
+
+void ClusterNode::OnNewConnection()
+{
+    while (server_.hasPendingConnections()) {
+        auto socket {server_.nextPendingConnection()};
+
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+            OnReadyRead(socket);
+        });
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+            pending_input_.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void ClusterNode::OnReadyRead(QLocalSocket* socket)
+{
+    auto& input {pending_input_[socket]};
+    input.append(socket->readAll());
+
+    ClusterMessage type;
+    QByteArray payload;
+    while (TakeClusterMessage(input, type, payload)) {
+        OnMessage(type, payload);
+    }
+}
+
+void ClusterNode::OnMessage(ClusterMessage type, const QByteArray& payload)
+{
+    QDataStream stream {payload};
+    stream.setVersion(CLUSTER_STREAM_VERSION);
+
+    switch (type) {
+    case ClusterMessage::kUrls:
+        ReceiveUrls(payload);
+        break;
+    case ClusterMessage::kProbe: {
+        quint32 wave {0};
+        stream >> wave;
+        SendStatus(wave);
+        break;
+    }
+    case ClusterMessage::kStop: {
+        bool is_found {false};
+        stream >> is_found;
+        StopCrawl(is_found);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void ClusterNode::ReceiveUrls(const QByteArray& payload)
+{
+    QDataStream stream {payload};
+    stream.setVersion(CLUSTER_STREAM_VERSION);
+
+    quint32 count {0};
+    stream >> count;
+    for (quint32 i = 0; i < count; ++i) {
+        QString url;
+        UrlHint hint;
+        stream >> url >> hint.relevance >> hint.parent;
+        if (stream.status() != QDataStream::Ok) {
+            break;
+        }
+
+        ++received_urls_;
+        PushUrl_(url, hint);
+    }
+}
+
+void ClusterNode::SendStatus(quint32 wave)
+{
+    // Idle first: an idle engine forwards nothing more, so the pending
+    // batches seen after it are all there will be
+    auto is_idle {IsIdle_() && !HasPendingUrls()};
+
+    QByteArray payload;
+    QDataStream stream {&payload, QIODevice::WriteOnly};
+    stream.setVersion(CLUSTER_STREAM_VERSION);
+    stream << wave << is_idle << static_cast<quint64>(forwarded_urls_)
+           << static_cast<quint64>(received_urls_) << CountPages_();
+    WriteClusterMessage(coordinator_, ClusterMessage::kStatus, payload);
+}
+
+bool ClusterNode::HasPendingUrls() const
+{
+    QMutexLocker locker(&mutex_);
+
+    return std::any_of(pending_urls_.begin(), pending_urls_.end(), [](const auto& batch) {
+        return !batch.empty();
+    });
+}
+
+QLocalSocket* ClusterNode::Peer(int node)
+{
+    auto& peer {peers_[node]};
+    if (!peer) {
+        peer = new QLocalSocket(this);
+    }
+
+    if (peer->state() == QLocalSocket::UnconnectedState) {
+        peer->connectToServer(NodeSocketName(options_.name, node));
+    }
+    return peer;
+}
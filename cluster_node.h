@@ -0,0 +1,111 @@
+#ifndef CLUSTERNODE_H
+#define CLUSTERNODE_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QMutex>
+#include <QTimer>
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+#include "cluster_protocol.h"
+#include "url_scorer.h"
+
+// One crawler process of a cluster, living in the thread it is created in.
+// Urls of the other partitions are batched per node and sent over local
+// sockets, urls received from the other nodes are pushed to the local
+// frontier. The coordinator probes the node for termination and stops it
+// once any node found the text or every node ran out of urls.
+class ClusterNode : public QObject
+{
+    Q_OBJECT
+
+public:
+    ClusterNode(
+        const ClusterOptions& options,
+        std::function<void(const QString&, const UrlHint&)> PushUrl,
+        std::function<bool()>                               IsIdle,
+        std::function<quint64()>                            CountPages,
+        std::function<void(bool)>                           Stop
+    );
+
+    ~ClusterNode();
+
+    // Listens for the other nodes and connects to the coordinator
+    bool Start();
+
+    // Sends what is pending and stops taking urls
+    void Close();
+
+    // Called from any thread
+    void Forward(int node, const QString& url, const UrlHint& hint);
+
+    // Called from any thread
+    void ReportFound(const QString& url);
+
+    ClusterStats Stats() const;
+
+private slots:
+    void Flush();
+
+    void SendFound(const QString& url);
+
+private:
+
+    struct ForwardedUrl
+    {
+        QString url;
+        UrlHint hint;
+    };
+
+    ClusterOptions  options_;
+    QLocalServer    server_ {};
+    QLocalSocket*   coordinator_ = nullptr;
+    QTimer          flush_timer_ {};
+    QElapsedTimer   connect_timer_ {};
+    bool            is_joined_ = false;
+    // Stop_ was called, only once per crawl
+    bool            is_stopped_ = false;
+
+    // Outgoing sockets by node, connected on the first batch
+    std::vector<QLocalSocket*>          peers_ {};
+    QHash<QLocalSocket*, QByteArray>    pending_input_ {};
+
+    mutable QMutex                              mutex_;
+    std::vector<std::vector<ForwardedUrl>>      pending_urls_ {};
+    bool                                        is_flush_queued_ = false;
+    bool                                        is_closed_ = false;
+
+    std::atomic<quint64>    forwarded_urls_ {0};
+    std::atomic<quint64>    received_urls_ {0};
+
+    std::function<void(const QString&, const UrlHint&)> PushUrl_;
+    std::function<bool()>                               IsIdle_;
+    std::function<quint64()>                            CountPages_;
+    std::function<void(bool)>                           Stop_;
+
+    void ConnectCoordinator();
+
+    void StopCrawl(bool is_found);
+
+    void OnNewConnection();
+
+    void OnReadyRead(QLocalSocket* socket);
+
+    void OnMessage(ClusterMessage type, const QByteArray& payload);
+
+    void ReceiveUrls(const QByteArray& payload);
+
+    void SendStatus(quint32 wave);
+
+    bool HasPendingUrls() const;
+
+    QLocalSocket* Peer(int node);
+};
+
+#endif // CLUSTERNODE_H
@@ -0,0 +1,55 @@
+#include "cluster_protocol.h"
+
+#include <QUrl>
+#include <QtEndian>
+
+#include "fingerprint.h"
+
+static constexpr auto MESSAGE_HEADER_SIZE = 1 + sizeof(quint32);
+// Seeded apart from the url fingerprints, so the partitions do not line
+// up with the seen set
+static constexpr quint64 PARTITION_SEED = 0x636c7573746572ULL;
+
+int HostPartition(const QString& url, int partitions)
+{
+    if (partitions <= 1) {
+        return 0;
+    }
+
+    auto host {QUrl(url).host().toUtf8()};
+    return static_cast<int>(Fingerprint64(host.constData(), host.size(), PARTITION_SEED) % partitions);
+}
+
+QString NodeSocketName(const QString& name, int node)
+{
+    return QString("%1-node-%2").arg(name).arg(node);
+}
+
+void WriteClusterMessage(QLocalSocket* socket, ClusterMessage type, const QByteArray& payload)
+{
+    auto size {qToLittleEndian<quint32>(static_cast<quint32>(payload.size()))};
+
+    QByteArray message;
+    message.reserve(static_cast<qsizetype>(MESSAGE_HEADER_SIZE) + payload.size());
+    message.append(static_cast<char>(type));
+    message.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    message.append(payload);
+    socket->write(message);
+}
+
+bool TakeClusterMessage(QByteArray& input, ClusterMessage& type, QByteArray& payload)
+{
+    if (input.size() < static_cast<qsizetype>(MESSAGE_HEADER_SIZE)) {
+        return false;
+    }
+
+    auto size {qFromLittleEndian<quint32>(input.constData() + 1)};
+    if (input.size() - static_cast<qsizetype>(MESSAGE_HEADER_SIZE) < static_cast<qsizetype>(size)) {
+        return false;
+    }
+
+    type = static_cast<ClusterMessage>(input.at(0));
+    payload = input.mid(MESSAGE_HEADER_SIZE, static_cast<qsizetype>(size));
+    input.remove(0, static_cast<qsizetype>(MESSAGE_HEADER_SIZE + size));
+    return true;
+}
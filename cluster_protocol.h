@@ -0,0 +1,65 @@
+#ifndef CLUSTERPROTOCOL_H
+#define CLUSTERPROTOCOL_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QLocalSocket>
+#include <QString>
+
+struct ClusterOptions
+{
+    // Local socket name of the coordinator, empty crawls in this process only
+    QString name {};
+    // Partition of the hosts crawled by this process, in [0, nodes)
+    int     node = 0;
+    int     nodes = 1;
+    // Urls of another partition sent to its node in one message
+    int     batch_size = 256;
+    // Longest time a forwarded url waits for its batch to fill
+    int     flush_interval = 50; // ms
+    // Time between two termination probes of the coordinator
+    int     probe_interval = 200; // ms
+};
+
+struct ClusterStats
+{
+    // Urls found here and sent to the node owning their host
+    quint64 forwarded = 0;
+    // Urls received from the other nodes
+    quint64 received = 0;
+    // Urls of the other nodes not sent, as they were sent before
+    quint64 suppressed = 0;
+};
+
+enum class ClusterMessage : quint8
+{
+    // Node to coordinator: node index and nodes count
+    kHello,
+    // Node to node: urls of the receiver's partition with their hints
+    kUrls,
+    // Coordinator to node: wave number
+    kProbe,
+    // Node to coordinator: wave number, idle, urls sent and received, pages
+    kStatus,
+    // Node to coordinator: url holding the text
+    kFound,
+    // Coordinator to node: whether the text was found, and where
+    kStop
+};
+
+static constexpr auto CLUSTER_STREAM_VERSION = QDataStream::Qt_5_12;
+
+// Partition owning the host of the url, the same in every process
+int HostPartition(const QString& url, int partitions);
+
+// Local socket name a node listens on for the urls of its partition
+QString NodeSocketName(const QString& name, int node);
+
+// Messages are framed as a type byte, the payload size as a little-endian
+// quint32 and the payload, written with QDataStream
+void WriteClusterMessage(QLocalSocket* socket, ClusterMessage type, const QByteArray& payload);
+
+// Takes the first whole message off the buffer, false until one arrived
+bool TakeClusterMessage(QByteArray& input, ClusterMessage& type, QByteArray& payload);
+
+#endif // CLUSTERPROTOCOL_H
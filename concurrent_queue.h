@@ -0,0 +1,123 @@
+#ifndef CONCURRENTQUEUE_H
+#define CONCURRENTQUEUE_H
+
+#include <QMutex>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+// Unbounded multi-producer multi-consumer FIFO with separate head and tail
+// locks (Michael & Scott two-lock queue), so producers never contend with
+// consumers. A dummy node keeps head and tail apart when the queue is empty.
+template <typename T>
+class ConcurrentQueue
+{
+public:
+    ConcurrentQueue() :
+        head_ {new Node {}},
+        tail_ {head_}
+    {
+
+    }
+
+    ~ConcurrentQueue()
+    {
+        Clear();
+        delete head_;
+    }
+
+    ConcurrentQueue(const ConcurrentQueue&) = delete;
+    ConcurrentQueue& operator=(const ConcurrentQueue&) = delete;
+
+    void Push(T value)
+    {
+        auto node {new Node {std::move(value)}};
+        {
+            QMutexLocker locker(&tail_mutex_);
+            tail_->next.store(node, std::memory_order_release);
+            tail_ = node;
+        }
+        ++size_;
+    }
+
+    bool TryPop(T& value)
+    {
+        Node* old_head {nullptr};
+        {
+            QMutexLocker locker(&head_mutex_);
+            auto next {head_->next.load(std::memory_order_acquire)};
+            if (next == nullptr) {
+                return false;
+            }
+            value = std::move(next->value);
+            old_head = head_;
+            head_ = next;
+        }
+        --size_;
+        delete old_head;
+        return true;
+    }
+
+    void Clear()
+    {
+        T value;
+        while (TryPop(value)) {
+        }
+    }
+
+    bool IsEmpty() const
+    {
+        return size_ <= 0;
+    }
+
+    // Copies the queued values in order, pushes and pops wait meanwhile
+    std::vector<T> Snapshot() const
+    {
+        QMutexLocker head_locker(&head_mutex_);
+        QMutexLocker tail_locker(&tail_mutex_);
+
+        std::vector<T> values;
+        for (auto node {head_->next.load(std::memory_order_acquire)}; node != nullptr;
+             node = node->next.load(std::memory_order_acquire)) {
+            values.push_back(node->value);
+        }
+        return values;
+    }
+
+    long Size() const
+    {
+        return std::max(size_.load(), 0L);
+    }
+
+private:
+
+    struct Node
+    {
+        Node() = default;
+
+        explicit Node(T&& node_value) :
+            value {std::move(node_value)}
+        {
+
+        }
+
+        T                   value {};
+        std::atomic<Node*>  next {nullptr};
+    };
+
+    // Padding keeps consumers, producers and the size counter on separate cache lines
+    mutable QMutex  head_mutex_;
+    Node*           head_;
+    char            head_padding_[64];
+
+    mutable QMutex  tail_mutex_;
+    Node*           tail_;
+    char            tail_padding_[64];
+
+    // Updated after the node is linked or unlinked, may lag behind by
+    // the pushes and pops in progress but never hides a linked node
+    std::atomic<long> size_ {0};
+};
+
+#endif // CONCURRENTQUEUE_H
@@ -0,0 +1,242 @@
+#include "content_decoder.h"
+
+#include <zlib.h>
+
+#ifdef WEBCRAWLER_HAVE_BROTLI
+#include <brotli/decode.h>
+#endif
+
+double TransferStats::CompressionRatio() const
+{
+    return received_bytes > 0 ? static_cast<double>(decoded_bytes) / received_bytes : 0.0;
+}
+
+void TransferCounters::Add(quint64 received_bytes, quint64 decoded_bytes)
+{
+    received_bytes_ += received_bytes;
+    decoded_bytes_ += decoded_bytes;
+}
+
+TransferStats TransferCounters::Stats() const
+{
+    TransferStats stats;
+    stats.received_bytes = received_bytes_;
+    stats.decoded_bytes = decoded_bytes_;
+    return stats;
+}
+
+struct ContentDecoder::Stream
+{
+    z_stream            zlib {};
+    bool                is_zlib_open = false;
+#ifdef WEBCRAWLER_HAVE_BROTLI
+    BrotliDecoderState* brotli = nullptr;
+#endif
+
+    ~Stream()
+    {
+        if (is_zlib_open) {
+            inflateEnd(&zlib);
+        }
+#ifdef WEBCRAWLER_HAVE_BROTLI
+        if (brotli) {
+            BrotliDecoderDestroyInstance(brotli);
+        }
+#endif
+    }
+};
+
+QByteArray ContentDecoder::AcceptEncoding()
+{
+#ifdef WEBCRAWLER_HAVE_BROTLI
+    return "br, gzip, deflate";
+#else
+    return "gzip, deflate";
+#endif
+}
+
+ContentDecoder::ContentDecoder(const QByteArray& content_encoding)
+{
+    auto name {content_encoding.trimmed().toLower()};
+
+    if (name.isEmpty() || name == "identity") {
+        encoding_ = Encoding::kIdentity;
+    }
+    else if (name == "gzip" || name == "x-gzip") {
+        encoding_ = Encoding::kGzip;
+    }
+    else if (name == "deflate") {
+        encoding_ = Encoding::kDeflate;
+    }
+#ifdef WEBCRAWLER_HAVE_BROTLI
+    else if (name == "br") {
+        encoding_ = Encoding::kBrotli;
+    }
+#endif
+    else {
+        // Stacked encodings too, servers only send them unasked
+        encoding_ = Encoding::kUnsupported;
+    }
+}
+
+ContentDecoder::~ContentDecoder() = default;
+
+bool ContentDecoder::Feed(const char* data, qint64 size, char* buffer, qint64 buffer_size, const Output& Write)
+{
+    if (is_finished_ || size <= 0) {
+        return true;
+    }
+
+    switch (encoding_) {
+    case Encoding::kIdentity:
+        Write(data, size);
+        return true;
+    case Encoding::kGzip:
+    case Encoding::kDeflate:
+        return Inflate(data, size, buffer, buffer_size, Write);
+    case Encoding::kBrotli:
+        return DecodeBrotli(data, size, buffer, buffer_size, Write);
+    default:
+        return false;
+    }
+}
+
+bool ContentDecoder::Finish(char* buffer, qint64 buffer_size, const Output& Write)
+{
+    if (encoding_ == Encoding::kIdentity) {
+        return true;
+    }
+
+    // An empty body has no stream to end
+    if (!stream_ && header_.isEmpty()) {
+        return true;
+    }
+
+    // A deflate body too short to tell its flavour never got to zlib
+    if (!stream_) {
+        QByteArray header;
+        header.swap(header_);
+        if (!Init(header.constData(), header.size())
+                || !Inflate(header.constData(), header.size(), buffer, buffer_size, Write)) {
+            return false;
+        }
+    }
+
+    return is_finished_;
+}
+
+// Private
+
+bool ContentDecoder::Init(const char* data, qint64 size)
+{
+    stream_.reset(new Stream);
+
+    if (encoding_ == Encoding::kBrotli) {
+#ifdef WEBCRAWLER_HAVE_BROTLI
+        stream_->brotli = BrotliDecoderCreateInstance(nullptr, nullptr, nullptr);
+        return stream_->brotli != nullptr;
+#else
+        return false;
+#endif
+    }
+
+    // 32 lets zlib tell a gzip from a zlib header. Plenty of servers send
+    // "deflate" as a raw stream without the zlib header, negative bits
+    // take it as such.
+    auto window_bits {15 + 32};
+    if (encoding_ == Encoding::kDeflate && size >= 2) {
+        auto cmf {static_cast<uchar>(data[0])};
+        auto flg {static_cast<uchar>(data[1])};
+        if ((cmf & 0x0F) != Z_DEFLATED || (cmf * 256 + flg) % 31 != 0) {
+            window_bits = -15;
+        }
+    }
+
+    stream_->is_zlib_open = inflateInit2(&stream_->zlib, window_bits) == Z_OK;
+    return stream_->is_zlib_open;
+}
+
+bool ContentDecoder::Inflate(const char* data, qint64 size, char* buffer, qint64 buffer_size, const Output& Write)
+{
+    if (!stream_) {
+        // The deflate flavour is told from the first two bytes, a chunk may hold only one
+        if (encoding_ == Encoding::kDeflate && header_.size() + size < 2) {
+            header_.append(data, size);
+            return true;
+        }
+        if (!header_.isEmpty()) {
+            header_.append(data, size);
+            data = header_.constData();
+            size = header_.size();
+        }
+
+        if (!Init(data, size)) {
+            return false;
+        }
+    }
+
+    auto& zlib {stream_->zlib};
+    zlib.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    zlib.avail_in = static_cast<uInt>(size);
+
+    do {
+        zlib.next_out = reinterpret_cast<Bytef*>(buffer);
+        zlib.avail_out = static_cast<uInt>(buffer_size);
+
+        auto result {inflate(&zlib, Z_NO_FLUSH)};
+        if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+            return false;
+        }
+
+        auto decoded_size {buffer_size - static_cast<qint64>(zlib.avail_out)};
+        if (decoded_size > 0 && !Write(buffer, decoded_size)) {
+            return true;
+        }
+
+        if (result == Z_STREAM_END) {
+            is_finished_ = true;
+            return true;
+        }
+    } while (zlib.avail_out == 0);
+
+    return true;
+}
+
+bool ContentDecoder::DecodeBrotli(const char* data, qint64 size, char* buffer, qint64 buffer_size, const Output& Write)
+{
+#ifdef WEBCRAWLER_HAVE_BROTLI
+    if (!stream_ && !Init(data, size)) {
+        return false;
+    }
+
+    auto next_in {reinterpret_cast<const uint8_t*>(data)};
+    auto available_in {static_cast<size_t>(size)};
+    BrotliDecoderResult result;
+
+    do {
+        auto next_out {reinterpret_cast<uint8_t*>(buffer)};
+        auto available_out {static_cast<size_t>(buffer_size)};
+
+        result = BrotliDecoderDecompressStream(
+            stream_->brotli, &available_in, &next_in, &available_out, &next_out, nullptr);
+        if (result == BROTLI_DECODER_RESULT_ERROR) {
+            return false;
+        }
+
+        auto decoded_size {buffer_size - static_cast<qint64>(available_out)};
+        if (decoded_size > 0 && !Write(buffer, decoded_size)) {
+            return true;
+        }
+    } while (result == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT);
+
+    is_finished_ = result == BROTLI_DECODER_RESULT_SUCCESS;
+    return true;
+#else
+    Q_UNUSED(data)
+    Q_UNUSED(size)
+    Q_UNUSED(buffer)
+    Q_UNUSED(buffer_size)
+    Q_UNUSED(Write)
+    return false;
+#endif
+}
@@ -0,0 +1,82 @@
+#ifndef CONTENTDECODER_H
+#define CONTENTDECODER_H
+
+#include <QByteArray>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+struct TransferStats
+{
+    // Body bytes as they came over the wire
+    quint64 received_bytes = 0;
+    // Body bytes after the content encoding was undone
+    quint64 decoded_bytes = 0;
+
+    double CompressionRatio() const;
+};
+
+class TransferCounters
+{
+public:
+    void Add(quint64 received_bytes, quint64 decoded_bytes);
+
+    TransferStats Stats() const;
+
+private:
+
+    std::atomic<quint64> received_bytes_ {0};
+    std::atomic<quint64> decoded_bytes_ {0};
+};
+
+// Undoes the Content-Encoding of a response body chunk by chunk. The
+// decoded bytes are handed out a buffer at a time as they are produced,
+// so a page is never held whole in its decoded form.
+class ContentDecoder
+{
+public:
+    // Gets a decoded piece, returns false to stop decoding
+    using Output = std::function<bool(const char*, qint64)>;
+
+    // Value of the Accept-Encoding request header
+    static QByteArray AcceptEncoding();
+
+    explicit ContentDecoder(const QByteArray& content_encoding);
+
+    ~ContentDecoder();
+
+    // Decodes data through buffer, false on an unsupported encoding or a
+    // corrupt stream. Bytes after the end of the stream are ignored.
+    bool Feed(const char* data, qint64 size, char* buffer, qint64 buffer_size, const Output& Write);
+
+    // Ends the body, decoding what is still held back through buffer.
+    // False when the stream stopped short of its end.
+    bool Finish(char* buffer, qint64 buffer_size, const Output& Write);
+
+private:
+
+    enum class Encoding
+    {
+        kIdentity,
+        kGzip,
+        kDeflate,
+        kBrotli,
+        kUnsupported
+    };
+
+    struct Stream;
+
+    Encoding                encoding_ = Encoding::kIdentity;
+    bool                    is_finished_ = false;
+    QByteArray              header_ {};
+    std::unique_ptr<Stream> stream_ {};
+
+    bool Init(const char* data, qint64 size);
+
+    bool Inflate(const char* data, qint64 size, char* buffer, qint64 buffer_size, const Output& Write);
+
+    bool DecodeBrotli(const char* data, qint64 size, char* buffer, qint64 buffer_size, const Output& Write);
+};
+
+#endif // CONTENTDECODER_H
@@ -0,0 +1,157 @@
+#include "content_index.h"
+
+#include <QtAlgorithms>
+
+#include <algorithm>
+
+static constexpr quint64 WORD_PRIME = 0x100000001b3ULL;
+static constexpr int MAX_DISTANCE = 16;
+// Below this many words the SimHash of a page says little, only exact
+// copies of it are detected
+static constexpr int SIMHASH_WORDS_MIN = 16;
+// Hashes kept per block value, a block shared by more pages than this is
+// no longer a good hint of a near duplicate
+static constexpr size_t BLOCK_HASHES_MAX = 64;
+
+static inline quint64 mixWords(quint64 previous, quint64 word)
+{
+    auto value {previous * 0x9e3779b97f4a7c15ULL + word};
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+static inline bool isWordByte(unsigned char c)
+{
+    // Bytes of UTF-8 sequences are kept, so words of any script count
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80;
+}
+
+ContentIndex::ContentIndex(const ContentOptions& options) :
+    max_distance_ {std::max(std::min(options.max_distance, MAX_DISTANCE), 0)}
+{
+    auto blocks_count {max_distance_ + 1};
+    auto shift {0};
+    for (int i = 0; i < blocks_count; ++i) {
+        // The first blocks take the bits that do not split evenly
+        auto bits {64 / blocks_count + (i < 64 % blocks_count ? 1 : 0)};
+        blocks_.push_back(Block {shift, bits == 64 ? ~0ULL : (1ULL << bits) - 1});
+        shift += bits;
+    }
+}
+
+void ContentIndex::Feed(Page& page, const char* data, size_t size) const
+{
+    page.exact.Feed(data, size);
+
+    for (size_t i = 0; i < size; ++i) {
+        auto c {static_cast<unsigned char>(data[i])};
+
+        if (page.in_tag) {
+            page.in_tag = c != '>';
+        }
+        else if (isWordByte(c)) {
+            if (c >= 'A' && c <= 'Z') {
+                c += 'a' - 'A';
+            }
+            page.word = (page.word ^ c) * WORD_PRIME;
+            ++page.word_size;
+        }
+        else {
+            EndWord(page);
+            page.in_tag = c == '<';
+        }
+    }
+}
+
+ContentMatch ContentIndex::Check(Page& page)
+{
+    EndWord(page);
+
+    auto exact {page.exact.Finish()};
+    auto simhash {SimHash(page)};
+    auto has_simhash {page.words >= SIMHASH_WORDS_MIN};
+
+    QMutexLocker locker(&mutex_);
+    ++stats_.pages;
+
+    if (!exact_.insert(exact).second) {
+        ++stats_.duplicates;
+        return ContentMatch::kDuplicate;
+    }
+
+    if (!has_simhash) {
+        return ContentMatch::kUnique;
+    }
+
+    if (HasNearDuplicate(simhash)) {
+        ++stats_.near_duplicates;
+        return ContentMatch::kNearDuplicate;
+    }
+
+    for (auto& block : blocks_) {
+        auto& hashes {block.hashes[(simhash >> block.shift) & block.mask]};
+        if (hashes.size() < BLOCK_HASHES_MAX) {
+            hashes.push_back(simhash);
+        }
+    }
+
+    return ContentMatch::kUnique;
+}
+
+ContentStats ContentIndex::Stats() const
+{
+    QMutexLocker locker(&mutex_);
+    return stats_;
+}
+
+// Private
+
+void ContentIndex::EndWord(Page& page)
+{
+    if (page.word_size == 0) {
+        return;
+    }
+
+    // Pairs of words, so the order of the text counts and not only its vocabulary
+    auto feature {mixWords(page.previous_word, page.word)};
+    for (int bit = 0; bit < 64; ++bit) {
+        page.weights[bit] += (feature >> bit) & 1 ? 1 : -1;
+    }
+
+    page.previous_word = page.word;
+    page.word = 0;
+    page.word_size = 0;
+    ++page.words;
+}
+
+quint64 ContentIndex::SimHash(const Page& page)
+{
+    quint64 simhash {0};
+    for (int bit = 0; bit < 64; ++bit) {
+        if (page.weights[bit] > 0) {
+            simhash |= 1ULL << bit;
+        }
+    }
+    return simhash;
+}
+
+bool ContentIndex::HasNearDuplicate(quint64 simhash) const
+{
+    for (const auto& block : blocks_) {
+        auto found {block.hashes.find((simhash >> block.shift) & block.mask)};
+        if (found == block.hashes.end()) {
+            continue;
+        }
+
+        for (auto hash : found->second) {
+            if (qPopulationCount(hash ^ simhash) <= static_cast<uint>(max_distance_)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,90 @@
+#ifndef CONTENTINDEX_H
+#define CONTENTINDEX_H
+
+#include <QMutex>
+
+#include <array>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "fingerprint.h"
+
+struct ContentOptions
+{
+    // Off fetches and follows every page whatever its content
+    bool    enabled = false;
+    // Bits two SimHashes may differ by and still be near duplicates, up to 16
+    int     max_distance = 3;
+};
+
+struct ContentStats
+{
+    // Pages checked against the index
+    quint64 pages = 0;
+    // Same bytes as a page checked before
+    quint64 duplicates = 0;
+    // Text within max_distance bits of a page checked before
+    quint64 near_duplicates = 0;
+};
+
+enum class ContentMatch
+{
+    kUnique,
+    kDuplicate,
+    kNearDuplicate
+};
+
+// Index of the bodies of the pages crawled so far, so mirrors and copies
+// are not crawled again: an exact hash of the body and a SimHash of the
+// pairs of words in its text, outside of the tags. Near duplicates are
+// looked up by splitting the SimHash in max_distance + 1 blocks, two
+// hashes within max_distance bits of each other share at least one.
+class ContentIndex
+{
+public:
+    // Hashes of a body while it streams in
+    struct Page
+    {
+        Fingerprint64Stream     exact {};
+        std::array<int, 64>     weights {};
+        quint64                 word = 0;
+        quint64                 previous_word = 0;
+        int                     word_size = 0;
+        int                     words = 0;
+        bool                    in_tag = false;
+    };
+
+    explicit ContentIndex(const ContentOptions& options);
+
+    void Feed(Page& page, const char* data, size_t size) const;
+
+    // Adds the page to the index, once its whole body was fed
+    ContentMatch Check(Page& page);
+
+    ContentStats Stats() const;
+
+private:
+
+    struct Block
+    {
+        int     shift;
+        quint64 mask;
+        // Hashes by the value of the block
+        std::unordered_map<quint64, std::vector<quint64>>   hashes {};
+    };
+
+    int                         max_distance_;
+    std::vector<Block>          blocks_ {};
+    std::unordered_set<quint64> exact_ {};
+    ContentStats                stats_ {};
+    mutable QMutex              mutex_;
+
+    static void EndWord(Page& page);
+
+    static quint64 SimHash(const Page& page);
+
+    bool HasNearDuplicate(quint64 simhash) const;
+};
+
+#endif // CONTENTINDEX_H
@@ -0,0 +1,95 @@
+#include "fingerprint.h"
+
+#include <cstring>
+
+static constexpr quint64 PRIME_1 = 0x87c37b91114253d5ULL;
+static constexpr quint64 PRIME_2 = 0x4cf5ad432745937fULL;
+
+static inline quint64 rotl(quint64 value, int shift)
+{
+    return (value << shift) | (value >> (64 - shift));
+}
+
+static inline quint64 fmix(quint64 value)
+{
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+static inline quint64 mixBlock(quint64 block)
+{
+    block *= PRIME_1;
+    block = rotl(block, 31);
+    block *= PRIME_2;
+    return block;
+}
+
+quint64 Fingerprint64(const void* data, size_t size, quint64 seed)
+{
+    auto bytes {static_cast<const unsigned char*>(data)};
+    quint64 hash {seed ^ (size * PRIME_1)};
+
+    size_t offset {0};
+    for (; offset + sizeof(quint64) <= size; offset += sizeof(quint64)) {
+        quint64 block;
+        std::memcpy(&block, bytes + offset, sizeof(block));
+        hash ^= mixBlock(block);
+        hash = rotl(hash, 27) * 5 + 0x52dce729;
+    }
+
+    quint64 tail {0};
+    for (size_t i = 0; offset + i < size; ++i) {
+        tail |= static_cast<quint64>(bytes[offset + i]) << (8 * i);
+    }
+    hash ^= mixBlock(tail);
+
+    return fmix(hash);
+}
+
+quint64 UrlFingerprint(const QString& url)
+{
+    return Fingerprint64(url.constData(), url.size() * sizeof(QChar));
+}
+
+Fingerprint64Stream::Fingerprint64Stream(quint64 seed) :
+    hash_ {seed}
+{
+
+}
+
+void Fingerprint64Stream::Feed(const void* data, size_t size)
+{
+    auto bytes {static_cast<const unsigned char*>(data)};
+    size_t offset {0};
+
+    // Completes the block left over from the previous piece
+    while (offset < size && size_ % sizeof(quint64) != 0) {
+        tail_ |= static_cast<quint64>(bytes[offset++]) << (8 * (size_++ % sizeof(quint64)));
+        if (size_ % sizeof(quint64) == 0) {
+            hash_ ^= mixBlock(tail_);
+            hash_ = rotl(hash_, 27) * 5 + 0x52dce729;
+            tail_ = 0;
+        }
+    }
+
+    for (; offset + sizeof(quint64) <= size; offset += sizeof(quint64)) {
+        quint64 block;
+        std::memcpy(&block, bytes + offset, sizeof(block));
+        hash_ ^= mixBlock(block);
+        hash_ = rotl(hash_, 27) * 5 + 0x52dce729;
+        size_ += sizeof(quint64);
+    }
+
+    for (; offset < size; ++offset) {
+        tail_ |= static_cast<quint64>(bytes[offset]) << (8 * (size_++ % sizeof(quint64)));
+    }
+}
+
+quint64 Fingerprint64Stream::Finish() const
+{
+    return fmix(hash_ ^ mixBlock(tail_) ^ (size_ * PRIME_1));
+}
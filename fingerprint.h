@@ -0,0 +1,33 @@
+#ifndef FINGERPRINT_H
+#define FINGERPRINT_H
+
+#include <QString>
+#include <QtGlobal>
+
+// 64-bit non-cryptographic hash (Murmur3-style block mixing with an fmix64
+// finalizer). Used wherever the crawler keys state by a hash instead of
+// storing the full string.
+quint64 Fingerprint64(const void* data, size_t size, quint64 seed = 0);
+
+quint64 UrlFingerprint(const QString& url);
+
+// Same mixing as Fingerprint64 over bytes fed in pieces. The result does
+// not depend on where the pieces are cut, but differs from Fingerprint64.
+class Fingerprint64Stream
+{
+public:
+    explicit Fingerprint64Stream(quint64 seed = 0);
+
+    void Feed(const void* data, size_t size);
+
+    quint64 Finish() const;
+
+private:
+
+    quint64 hash_;
+    quint64 size_ = 0;
+    // Bytes of the block not yet complete, little endian
+    quint64 tail_ = 0;
+};
+
+#endif // FINGERPRINT_H
@@ -0,0 +1,319 @@
+#include "frontier_store.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QSaveFile>
+#include <QSet>
+#include <QtEndian>
+
+#include <algorithm>
+
+static constexpr quint32 CHECKPOINT_MAGIC = 0x57434653; // "WCFS"
+static constexpr quint32 CHECKPOINT_VERSION = 1;
+static constexpr auto FLUSH_SIZE = 64 * 1024; // bytes
+static constexpr auto FLUSH_INTERVAL = 200; // ms
+static constexpr auto RECORD_HEADER_SIZE = 1 + sizeof(quint32);
+
+static constexpr auto CHECKPOINT_NAME = "checkpoint";
+static constexpr auto LOG_NAME = "log";
+
+FrontierStore::FrontierStore() = default;
+
+FrontierStore::~FrontierStore()
+{
+    Close();
+}
+
+bool FrontierStore::Load(const QString& dir, FrontierSnapshot& snapshot, QStringList& admitted)
+{
+    auto checkpoints {Generations(dir, CHECKPOINT_NAME)};
+    std::sort(checkpoints.begin(), checkpoints.end(), std::greater<quint64>());
+
+    // A checkpoint cut short by a crash is skipped for the one before it
+    quint64 generation {0};
+    bool is_loaded {false};
+    for (auto checkpoint : checkpoints) {
+        QFile file {FilePath(dir, CHECKPOINT_NAME, checkpoint)};
+        if (!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+
+        QDataStream stream {&file};
+        stream.setVersion(QDataStream::Qt_5_12);
+
+        quint32 magic {0};
+        quint32 version {0};
+        stream >> magic >> version >> generation >> snapshot.seen >> snapshot.pending;
+        if (stream.status() == QDataStream::Ok && magic == CHECKPOINT_MAGIC && version == CHECKPOINT_VERSION) {
+            is_loaded = true;
+            break;
+        }
+    }
+
+    if (!is_loaded) {
+        return false;
+    }
+
+    QSet<QString> known {};
+    QSet<QString> completed {};
+    for (const auto& url : snapshot.pending) {
+        known.insert(url);
+    }
+
+    auto logs {Generations(dir, LOG_NAME)};
+    std::sort(logs.begin(), logs.end());
+    for (auto log : logs) {
+        if (log < generation) {
+            continue;
+        }
+
+        QFile file {FilePath(dir, LOG_NAME, log)};
+        if (!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+
+        // Stops at a record torn by a crash
+        auto data {file.readAll()};
+        qsizetype pos {0};
+        while (data.size() - pos >= static_cast<qsizetype>(RECORD_HEADER_SIZE)) {
+            auto record {static_cast<FrontierRecord>(data[pos])};
+            auto size {qFromLittleEndian<quint32>(data.constData() + pos + 1)};
+            if (data.size() - pos - static_cast<qsizetype>(RECORD_HEADER_SIZE) < static_cast<qsizetype>(size)) {
+                break;
+            }
+
+            auto url {QString::fromUtf8(data.constData() + pos + RECORD_HEADER_SIZE, size)};
+            pos += RECORD_HEADER_SIZE + size;
+
+            if (record == FrontierRecord::kCompleted) {
+                completed.insert(url);
+            }
+            else if (record == FrontierRecord::kAdmitted && !known.contains(url)) {
+                known.insert(url);
+                snapshot.pending.append(url);
+                admitted.append(url);
+            }
+        }
+    }
+
+    QStringList pending;
+    for (const auto& url : snapshot.pending) {
+        if (!completed.contains(url)) {
+            pending.append(url);
+        }
+    }
+    snapshot.pending.swap(pending);
+
+    return true;
+}
+
+bool FrontierStore::Open(
+    const QString& dir,
+    int checkpoint_interval,
+    std::function<FrontierSnapshot()> TakeSnapshot
+)
+{
+    Close();
+
+    if (!QDir().mkpath(dir)) {
+        qWarning() << "Frontier store: cannot create" << dir;
+        return false;
+    }
+
+    dir_ = dir;
+    checkpoint_interval_ = std::max(checkpoint_interval, 0);
+    TakeSnapshot_ = TakeSnapshot;
+
+    // Continue the numbering so the new files never collide with the old ones
+    auto generations {Generations(dir, CHECKPOINT_NAME) + Generations(dir, LOG_NAME)};
+    generation_ = generations.isEmpty() ? 0 : *std::max_element(generations.begin(), generations.end());
+
+    buffer_.clear();
+    is_closing_ = false;
+    is_checkpoint_requested_ = false;
+
+    if (!WriteCheckpoint()) {
+        log_.close();
+        return false;
+    }
+
+    {
+        QMutexLocker locker(&mutex_);
+        is_open_ = true;
+    }
+
+    writer_.reset(QThread::create([this]() {
+        Run();
+    }));
+    writer_->start();
+    return true;
+}
+
+void FrontierStore::Append(FrontierRecord record, const QString& url)
+{
+    auto data {url.toUtf8()};
+    auto size {qToLittleEndian<quint32>(static_cast<quint32>(data.size()))};
+
+    QMutexLocker locker(&mutex_);
+
+    if (!is_open_ || is_closing_) {
+        return;
+    }
+
+    buffer_.append(static_cast<char>(record));
+    buffer_.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    buffer_.append(data);
+
+    if (buffer_.size() >= FLUSH_SIZE) {
+        state_changed_.wakeOne();
+    }
+}
+
+void FrontierStore::RequestCheckpoint()
+{
+    QMutexLocker locker(&mutex_);
+
+    is_checkpoint_requested_ = true;
+    state_changed_.wakeOne();
+}
+
+void FrontierStore::Close()
+{
+    {
+        QMutexLocker locker(&mutex_);
+
+        if (!is_open_) {
+            return;
+        }
+        is_closing_ = true;
+        state_changed_.wakeOne();
+    }
+
+    writer_->wait();
+    writer_.reset();
+    log_.close();
+
+    QMutexLocker locker(&mutex_);
+    is_open_ = false;
+}
+
+bool FrontierStore::IsOpen() const
+{
+    QMutexLocker locker(&mutex_);
+
+    return is_open_ && !is_closing_;
+}
+
+// Private
+
+QString FrontierStore::FilePath(const QString& dir, const char* name, quint64 generation)
+{
+    return QDir(dir).filePath(QString("%1.%2").arg(QLatin1String(name)).arg(generation));
+}
+
+QList<quint64> FrontierStore::Generations(const QString& dir, const char* name)
+{
+    QList<quint64> generations;
+
+    auto prefix {QString("%1.").arg(QLatin1String(name))};
+    for (const auto& file : QDir(dir).entryList({prefix + "*"}, QDir::Files)) {
+        bool is_number {false};
+        auto generation {file.mid(prefix.size()).toULongLong(&is_number)};
+        if (is_number) {
+            generations.append(generation);
+        }
+    }
+
+    return generations;
+}
+
+void FrontierStore::Run()
+{
+    QElapsedTimer since_checkpoint;
+    since_checkpoint.start();
+
+    QMutexLocker locker(&mutex_);
+
+    while (true) {
+        if (!is_closing_ && !is_checkpoint_requested_ && buffer_.size() < FLUSH_SIZE) {
+            state_changed_.wait(&mutex_, FLUSH_INTERVAL);
+        }
+
+        auto is_closing {is_closing_};
+        auto is_checkpoint_due {is_closing || is_checkpoint_requested_
+                                || (checkpoint_interval_ > 0 && since_checkpoint.elapsed() >= checkpoint_interval_)};
+        is_checkpoint_requested_ = false;
+        locker.unlock();
+
+        if (is_checkpoint_due) {
+            WriteCheckpoint();
+            since_checkpoint.restart();
+        }
+        else {
+            FlushBuffer();
+        }
+
+        if (is_closing) {
+            break;
+        }
+        locker.relock();
+    }
+}
+
+void FrontierStore::FlushBuffer()
+{
+    QByteArray data;
+    {
+        QMutexLocker locker(&mutex_);
+        data.swap(buffer_);
+    }
+
+    if (!data.isEmpty() && log_.isOpen()) {
+        log_.write(data);
+        log_.flush();
+    }
+}
+
+bool FrontierStore::WriteCheckpoint()
+{
+    // Appends made from here on belong to the next generation's log
+    FlushBuffer();
+    log_.close();
+
+    ++generation_;
+    log_.setFileName(FilePath(dir_, LOG_NAME, generation_));
+    if (!log_.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Frontier store: cannot open" << log_.fileName();
+        return false;
+    }
+
+    auto snapshot {TakeSnapshot_()};
+
+    QSaveFile file {FilePath(dir_, CHECKPOINT_NAME, generation_)};
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Frontier store: cannot write" << file.fileName();
+        return false;
+    }
+
+    QDataStream stream {&file};
+    stream.setVersion(QDataStream::Qt_5_12);
+    stream << CHECKPOINT_MAGIC << CHECKPOINT_VERSION << generation_ << snapshot.seen << snapshot.pending;
+
+    if (stream.status() != QDataStream::Ok || !file.commit()) {
+        qWarning() << "Frontier store: cannot write" << file.fileName();
+        return false;
+    }
+
+    // The new checkpoint covers everything the older files held
+    for (const auto name : {CHECKPOINT_NAME, LOG_NAME}) {
+        for (auto generation : Generations(dir_, name)) {
+            if (generation < generation_) {
+                QFile::remove(FilePath(dir_, name, generation));
+            }
+        }
+    }
+
+    return true;
+}
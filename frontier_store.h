@@ -0,0 +1,95 @@
+#ifndef FRONTIERSTORE_H
+#define FRONTIERSTORE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QStringList>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <functional>
+#include <memory>
+
+enum class FrontierRecord : quint8
+{
+    // Passed the seen check and was queued
+    kAdmitted = 'A',
+    // Fetched, it is not queued again on resume
+    kCompleted = 'C'
+};
+
+struct FrontierSnapshot
+{
+    // SeenUrlSet::Save output
+    QByteArray  seen {};
+    // Queued and in-flight urls, in the order to fetch them on resume
+    QStringList pending {};
+};
+
+// Persists the frontier as generations in a directory: checkpoint.<n>
+// holds the whole frontier, log.<n> the urls admitted and completed since.
+// The log is started before the checkpoint is taken, so the two overlap
+// rather than leave a gap, and replaying the log ignores what the
+// checkpoint already has. Appends are buffered in memory and written by
+// a background thread in batches.
+class FrontierStore
+{
+public:
+    FrontierStore();
+
+    ~FrontierStore();
+
+    // Reads the newest complete checkpoint in dir and replays the logs
+    // after it. admitted gets the urls to add to the restored seen set.
+    static bool Load(const QString& dir, FrontierSnapshot& snapshot, QStringList& admitted);
+
+    // Starts a new generation in dir with a checkpoint of TakeSnapshot,
+    // the files of older generations are removed once it is written
+    bool Open(
+        const QString& dir,
+        int checkpoint_interval,
+        std::function<FrontierSnapshot()> TakeSnapshot
+    );
+
+    void Append(FrontierRecord record, const QString& url);
+
+    // Has the background thread write a checkpoint as soon as it can
+    void RequestCheckpoint();
+
+    // Flushes the log and writes a last checkpoint
+    void Close();
+
+    bool IsOpen() const;
+
+private:
+
+    QString     dir_ {};
+    int         checkpoint_interval_ = 0; // ms
+    quint64     generation_ = 0;
+    QFile       log_ {};
+
+    std::function<FrontierSnapshot()>   TakeSnapshot_;
+
+    // Guards the buffer and the flags, the files belong to the writer thread
+    mutable QMutex  mutex_;
+    QWaitCondition  state_changed_;
+    QByteArray      buffer_ {};
+    bool            is_open_ = false;
+    bool            is_closing_ = false;
+    bool            is_checkpoint_requested_ = false;
+
+    std::unique_ptr<QThread>    writer_ {};
+
+    static QString FilePath(const QString& dir, const char* name, quint64 generation);
+
+    static QList<quint64> Generations(const QString& dir, const char* name);
+
+    void Run();
+
+    void FlushBuffer();
+
+    bool WriteCheckpoint();
+};
+
+#endif // FRONTIERSTORE_H
@@ -0,0 +1,63 @@
+#include "host_resolver.h"
+
+#include <QHostAddress>
+
+double ResolverStats::NegativeHitRate() const
+{
+    return lookups > 0 ? static_cast<double>(negative_hits) / lookups : 0.0;
+}
+
+HostResolver::HostResolver(const ResolverOptions& options) :
+    options_ {options}
+{
+    clock_.start();
+}
+
+bool HostResolver::IsNotFound(const QString& host)
+{
+    if (host.isEmpty() || IsAddress(host)) {
+        return false;
+    }
+
+    ++lookups_;
+
+    QMutexLocker locker(&mutex_);
+
+    auto entryIt {not_found_.find(host)};
+    if (entryIt == not_found_.end()) {
+        return false;
+    }
+    if (*entryIt <= clock_.elapsed()) {
+        not_found_.erase(entryIt);
+        return false;
+    }
+
+    ++negative_hits_;
+    return true;
+}
+
+void HostResolver::SetNotFound(const QString& host)
+{
+    if (host.isEmpty() || IsAddress(host)) {
+        return;
+    }
+
+    QMutexLocker locker(&mutex_);
+
+    not_found_.insert(host, clock_.elapsed() + options_.negative_ttl);
+}
+
+ResolverStats HostResolver::Stats() const
+{
+    ResolverStats stats;
+    stats.lookups = lookups_;
+    stats.negative_hits = negative_hits_;
+    return stats;
+}
+
+// Private
+
+bool HostResolver::IsAddress(const QString& host)
+{
+    return !QHostAddress(host).isNull();
+}
@@ -0,0 +1,57 @@
+#ifndef HOSTRESOLVER_H
+#define HOSTRESOLVER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+#include <atomic>
+
+struct ResolverOptions
+{
+    int negative_ttl = 30000; // ms
+};
+
+struct ResolverStats
+{
+    // Fetches checked against the hosts not found, and those failed by it
+    quint64 lookups = 0;
+    quint64 negative_hits = 0;
+
+    // Share of the lookups failed without a request
+    double NegativeHitRate() const;
+};
+
+// Hosts a fetch did not find, shared by all workers. Their other urls are
+// failed without a request until the entry expires. Hosts that resolve are
+// not kept here, QNetworkAccessManager looks them up itself.
+class HostResolver
+{
+public:
+    explicit HostResolver(const ResolverOptions& options = ResolverOptions {});
+
+    // Counts the lookup of the host of a url about to be fetched
+    bool IsNotFound(const QString& host);
+
+    // Records a host not found by a fetch
+    void SetNotFound(const QString& host);
+
+    ResolverStats Stats() const;
+
+private:
+
+    ResolverOptions         options_;
+
+    mutable QMutex          mutex_;
+    // Expiry of each host not found, ms of clock_
+    QHash<QString, qint64>  not_found_ {};
+    QElapsedTimer           clock_ {};
+
+    std::atomic<quint64>    lookups_ {0};
+    std::atomic<quint64>    negative_hits_ {0};
+
+    static bool IsAddress(const QString& host);
+};
+
+#endif // HOSTRESOLVER_H
@@ -6,12 +6,14 @@
 #include <QRegularExpressionValidator>
 
 static const auto       IDEAL_THREAD_COUNT = QThread::idealThreadCount();
-static constexpr auto   MAX_URLS_COUNT = 9999;
+static constexpr auto   MAX_REQUESTS_COUNT = 256;
+static constexpr auto   MAX_URLS_COUNT = 99999999;
 
 InputWindow::InputWindow(QWidget *parent) :
     QWidget(parent),
     ui(new Ui::InputWindow),
-    max_threads_ {"1"}
+    max_threads_ {"1"},
+    max_requests_ {"1"}
 {
     ui->setupUi(this);
     setFixedSize(size());
@@ -27,6 +29,9 @@ InputWindow::InputWindow(QWidget *parent) :
     ui->maxThreads->setText("Threads Max Number (1 - " + QString::number(IDEAL_THREAD_COUNT) + ") :");
     ui->maxThreadsSpinBox->setMaximum(IDEAL_THREAD_COUNT);
 
+    ui->maxRequests->setText("Requests Per Thread (1 - " + QString::number(MAX_REQUESTS_COUNT) + ") :");
+    ui->maxRequestsSpinBox->setMaximum(MAX_REQUESTS_COUNT);
+
     ui->maxUrlsLabel->setText("Urls Max Number (1 - " + QString::number(MAX_URLS_COUNT) + ") :");
     ui->maxUrlsLineEdit->setValidator(new QIntValidator(1, MAX_URLS_COUNT, ui->maxUrlsLineEdit));
 }
@@ -46,6 +51,11 @@ void InputWindow::on_maxThreadsSpinBox_textChanged(const QString &arg1)
     InputWindow::max_threads_ = arg1;
 }
 
+void InputWindow::on_maxRequestsSpinBox_textChanged(const QString &arg1)
+{
+    InputWindow::max_requests_ = arg1;
+}
+
 void InputWindow::on_searchTextLineEdit_textEdited(const QString &arg1)
 {
     InputWindow::search_text_ = arg1;
@@ -78,6 +88,11 @@ QString InputWindow::GetMaxThreads() const
     return max_threads_;
 }
 
+QString InputWindow::GetMaxRequests() const
+{
+    return max_requests_;
+}
+
 QString InputWindow::GetSearchText() const
 {
     return search_text_;
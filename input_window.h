@@ -17,6 +17,7 @@ public:
 
     QString GetStartUrl() const;
     QString GetMaxThreads() const;
+    QString GetMaxRequests() const;
     QString GetSearchText() const;
     QString GetMaxUrls() const;
 
@@ -29,6 +30,8 @@ private slots:
 
     void on_maxThreadsSpinBox_textChanged(const QString &arg1);
 
+    void on_maxRequestsSpinBox_textChanged(const QString &arg1);
+
     void on_searchTextLineEdit_textEdited(const QString &arg1);
 
     void on_maxUrlsLineEdit_textEdited(const QString &arg1);
@@ -42,6 +45,7 @@ private:
 
     QString start_url_;
     QString max_threads_;
+    QString max_requests_;
     QString search_text_;
     QString max_urls_;
 
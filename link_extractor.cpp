@@ -0,0 +1,393 @@
+#include "link_extractor.h"
+
+#include <algorithm>
+#include <cstring>
+
+static constexpr int NAME_SIZE_MAX = 16;
+static constexpr int VALUE_SIZE_MAX = 4096;
+static constexpr int ANCHOR_TEXT_SIZE_MAX = 256;
+// Longest character reference decoded in a link, "&#x10FFFF;"
+static constexpr int REFERENCE_SIZE_MAX = 10;
+
+static inline bool isSpace(char byte)
+{
+    return byte == ' ' || byte == '\t' || byte == '\n' || byte == '\r' || byte == '\f';
+}
+
+static inline char toLower(char byte)
+{
+    return (byte >= 'A' && byte <= 'Z') ? byte + ('a' - 'A') : byte;
+}
+
+static inline void appendBounded(QByteArray& target, const char* data, size_t size, int limit)
+{
+    auto room {limit - target.size()};
+    if (room > 0) {
+        target.append(data, static_cast<int>(std::min<size_t>(size, room)));
+    }
+}
+
+static bool isLinkAttribute(const QByteArray& tag_name, const QByteArray& attribute_name)
+{
+    if (attribute_name == "href") {
+        return tag_name == "a" || tag_name == "area" || tag_name == "base";
+    }
+    if (attribute_name == "src") {
+        return tag_name == "frame" || tag_name == "iframe";
+    }
+    return false;
+}
+
+// Undoes &amp; and the numeric character references, other named ones are
+// left as they are
+static QString decodeReferences(const QString& text)
+{
+    if (!text.contains('&')) {
+        return text;
+    }
+
+    QString decoded;
+    decoded.reserve(text.size());
+
+    int i {0};
+    while (i < text.size()) {
+        auto end {text[i] == '&' ? text.indexOf(';', i + 1) : -1};
+        auto name {end > i && end - i <= REFERENCE_SIZE_MAX ? text.mid(i + 1, end - i - 1) : QString()};
+
+        uint code_point {0};
+        bool is_number {false};
+        if (name.startsWith("#x") || name.startsWith("#X")) {
+            code_point = name.mid(2).toUInt(&is_number, 16);
+        }
+        else if (name.startsWith('#')) {
+            code_point = name.mid(1).toUInt(&is_number, 10);
+        }
+
+        if (name == "amp") {
+            decoded.append('&');
+        }
+        else if (is_number && code_point > 0 && code_point <= 0x10FFFF) {
+            if (QChar::requiresSurrogates(code_point)) {
+                decoded.append(QChar(QChar::highSurrogate(code_point)));
+                decoded.append(QChar(QChar::lowSurrogate(code_point)));
+            }
+            else {
+                decoded.append(QChar(static_cast<ushort>(code_point)));
+            }
+        }
+        else {
+            decoded.append(text[i]);
+            ++i;
+            continue;
+        }
+
+        i = end + 1;
+    }
+
+    return decoded;
+}
+
+LinkExtractor::LinkExtractor() = default;
+
+LinkExtractor::LinkExtractor(const QUrl& page_url, bool keep_anchor_text) :
+    base_url_ {page_url},
+    keep_anchor_text_ {keep_anchor_text}
+{
+    // Emptied with resize(0) from then on, so the tags of a page reuse them
+    tag_name_.reserve(NAME_SIZE_MAX);
+    attribute_name_.reserve(NAME_SIZE_MAX);
+}
+
+void LinkExtractor::Feed(const char* data, size_t size)
+{
+    size_t i {0};
+
+    while (i < size) {
+        auto byte {data[i]};
+
+        switch (state_) {
+        case State::kText:
+        {
+            auto tag {static_cast<const char*>(std::memchr(data + i, '<', size - i))};
+            if (anchor_link_ >= 0) {
+                auto text_end {tag != nullptr ? static_cast<size_t>(tag - data) : size};
+                appendBounded(anchor_texts_[anchor_link_], data + i, text_end - i, ANCHOR_TEXT_SIZE_MAX);
+            }
+            if (tag == nullptr) {
+                return;
+            }
+            i = tag - data + 1;
+            tag_name_.resize(0);
+            tag_link_ = -1;
+            state_ = State::kTagOpen;
+            continue;
+        }
+        case State::kTagOpen:
+            if (byte == '!') {
+                end_matched_ = 0;
+                state_ = State::kMarkupDeclaration;
+            }
+            else if (byte == '/' || byte == '?') {
+                anchor_link_ = -1;
+                state_ = State::kEndTag;
+            }
+            else if ((byte >= 'a' && byte <= 'z') || (byte >= 'A' && byte <= 'Z')) {
+                tag_name_.append(toLower(byte));
+                state_ = State::kTagName;
+            }
+            else {
+                // A stray '<' in text, rescan this byte as text
+                state_ = State::kText;
+                continue;
+            }
+            break;
+        case State::kMarkupDeclaration:
+            // "<!--" opens a comment, anything else (doctype, cdata) ends at '>'
+            if (byte == '-' && ++end_matched_ == 2) {
+                end_matched_ = 0;
+                state_ = State::kComment;
+            }
+            else if (byte != '-') {
+                state_ = State::kEndTag;
+                continue;
+            }
+            break;
+        case State::kTagName:
+            if (isSpace(byte) || byte == '/') {
+                state_ = State::kBeforeAttributeName;
+            }
+            else if (byte == '>') {
+                EndTag();
+            }
+            else if (tag_name_.size() < NAME_SIZE_MAX) {
+                tag_name_.append(toLower(byte));
+            }
+            break;
+        case State::kEndTag:
+        {
+            auto end {static_cast<const char*>(std::memchr(data + i, '>', size - i))};
+            if (end == nullptr) {
+                return;
+            }
+            i = end - data + 1;
+            state_ = State::kText;
+            continue;
+        }
+        case State::kBeforeAttributeName:
+            if (byte == '>') {
+                EndTag();
+            }
+            else if (!isSpace(byte) && byte != '/') {
+                BeginAttribute(byte);
+            }
+            break;
+        case State::kAttributeName:
+            if (byte == '=') {
+                BeginAttributeValue();
+            }
+            else if (isSpace(byte)) {
+                state_ = State::kAfterAttributeName;
+            }
+            else if (byte == '>') {
+                EndAttribute();
+                EndTag();
+            }
+            else if (byte == '/') {
+                EndAttribute();
+            }
+            else if (attribute_name_.size() < NAME_SIZE_MAX) {
+                attribute_name_.append(toLower(byte));
+            }
+            break;
+        case State::kAfterAttributeName:
+            if (byte == '=') {
+                BeginAttributeValue();
+            }
+            else if (byte == '>') {
+                EndAttribute();
+                EndTag();
+            }
+            else if (!isSpace(byte)) {
+                EndAttribute();
+                BeginAttribute(byte);
+            }
+            break;
+        case State::kBeforeAttributeValue:
+            if (byte == '"' || byte == '\'') {
+                quote_ = byte;
+                state_ = State::kAttributeValueQuoted;
+            }
+            else if (byte == '>') {
+                EndAttribute();
+                EndTag();
+            }
+            else if (!isSpace(byte)) {
+                state_ = State::kAttributeValueUnquoted;
+                continue;
+            }
+            break;
+        case State::kAttributeValueQuoted:
+        {
+            auto end {static_cast<const char*>(std::memchr(data + i, quote_, size - i))};
+            auto value_size {end != nullptr ? static_cast<size_t>(end - data) - i : size - i};
+            if (is_link_attribute_) {
+                appendBounded(attribute_value_, data + i, value_size, VALUE_SIZE_MAX);
+            }
+            if (end == nullptr) {
+                return;
+            }
+            EndAttribute();
+            i = end - data + 1;
+            continue;
+        }
+        case State::kAttributeValueUnquoted:
+            if (isSpace(byte)) {
+                EndAttribute();
+            }
+            else if (byte == '>') {
+                EndAttribute();
+                EndTag();
+            }
+            else if (is_link_attribute_ && attribute_value_.size() < VALUE_SIZE_MAX) {
+                attribute_value_.append(byte);
+            }
+            break;
+        case State::kComment:
+            if (byte == '-') {
+                ++end_matched_;
+            }
+            else if (byte == '>' && end_matched_ >= 2) {
+                state_ = State::kText;
+            }
+            else {
+                end_matched_ = 0;
+                auto dash {static_cast<const char*>(std::memchr(data + i, '-', size - i))};
+                if (dash == nullptr) {
+                    return;
+                }
+                i = dash - data;
+                continue;
+            }
+            break;
+        case State::kRawText:
+            // Looking for "</" followed by the element name
+            if (end_matched_ == 0) {
+                auto tag {static_cast<const char*>(std::memchr(data + i, '<', size - i))};
+                if (tag == nullptr) {
+                    return;
+                }
+                i = tag - data + 1;
+                end_matched_ = 1;
+                continue;
+            }
+            if (end_matched_ == tag_name_.size() + 2) {
+                // The name must end there, "</scripts" is still script text
+                if (isSpace(byte) || byte == '/' || byte == '>') {
+                    state_ = State::kEndTag;
+                }
+                else {
+                    end_matched_ = 0;
+                }
+                continue;
+            }
+            if ((end_matched_ == 1 && byte == '/')
+                    || (end_matched_ > 1 && toLower(byte) == tag_name_[end_matched_ - 2])) {
+                ++end_matched_;
+            }
+            else {
+                end_matched_ = 0;
+                continue;
+            }
+            break;
+        }
+
+        ++i;
+    }
+}
+
+QStringList LinkExtractor::TakeLinks()
+{
+    QList<QByteArray> anchor_texts;
+    return TakeLinks(anchor_texts);
+}
+
+QStringList LinkExtractor::TakeLinks(QList<QByteArray>& anchor_texts)
+{
+    QStringList links;
+    links.swap(links_);
+    anchor_texts.clear();
+    anchor_texts.swap(anchor_texts_);
+    tag_link_ = -1;
+    anchor_link_ = -1;
+    return links;
+}
+
+// Private
+
+void LinkExtractor::BeginAttribute(char byte)
+{
+    attribute_name_.resize(0);
+    attribute_name_.append(toLower(byte));
+    state_ = State::kAttributeName;
+}
+
+void LinkExtractor::BeginAttributeValue()
+{
+    is_link_attribute_ = isLinkAttribute(tag_name_, attribute_name_);
+    attribute_value_.clear();
+    state_ = State::kBeforeAttributeValue;
+}
+
+void LinkExtractor::EndAttribute()
+{
+    if (is_link_attribute_ && !attribute_value_.isEmpty()) {
+        if (tag_name_ == "base" && attribute_name_ == "href") {
+            if (!has_base_tag_) {
+                has_base_tag_ = true;
+                auto href {decodeReferences(QString::fromUtf8(attribute_value_).trimmed())};
+                base_url_ = base_url_.resolved(QUrl(href));
+            }
+        }
+        else {
+            AddLink(attribute_value_);
+        }
+    }
+
+    attribute_name_.resize(0);
+    attribute_value_.clear();
+    is_link_attribute_ = false;
+    state_ = State::kBeforeAttributeName;
+}
+
+void LinkExtractor::EndTag()
+{
+    if (tag_link_ >= 0 && tag_name_ == "a") {
+        anchor_link_ = tag_link_;
+    }
+
+    if (tag_name_ == "script" || tag_name_ == "style") {
+        end_matched_ = 0;
+        state_ = State::kRawText;
+    }
+    else {
+        state_ = State::kText;
+    }
+}
+
+void LinkExtractor::AddLink(const QByteArray& value)
+{
+    auto text {decodeReferences(QString::fromUtf8(value).trimmed())};
+    if (text.isEmpty() || text.startsWith('#')) {
+        return;
+    }
+
+    auto url {base_url_.resolved(QUrl(text))};
+    auto scheme {url.scheme()};
+    if (url.isValid() && (scheme == "http" || scheme == "https") && !url.host().isEmpty()) {
+        links_.push_back(url.toString(QUrl::FullyEncoded));
+        if (keep_anchor_text_) {
+            anchor_texts_.push_back(QByteArray());
+            tag_link_ = links_.size() - 1;
+        }
+    }
+}
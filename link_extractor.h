@@ -0,0 +1,85 @@
+#ifndef LINKEXTRACTOR_H
+#define LINKEXTRACTOR_H
+
+#include <QByteArray>
+#include <QList>
+#include <QStringList>
+#include <QUrl>
+
+// Single-pass HTML tokenizer that collects the links of a page while its
+// body streams in. Works on raw bytes and keeps its position between
+// chunks, so it can run on each chunk right after the text matcher.
+//
+// Only the href of <a>, <area> and <base> tags and the src of <frame> and
+// <iframe> tags are taken, resolved against the page url or its <base href>;
+// comments, script and style contents are skipped. Links that do not
+// resolve to http(s) urls are dropped.
+//
+// With keep_anchor_text an <a href> link also keeps the raw bytes of the
+// text after its tag, up to the first end tag of any element.
+class LinkExtractor
+{
+public:
+    LinkExtractor();
+
+    explicit LinkExtractor(const QUrl& page_url, bool keep_anchor_text = false);
+
+    void Feed(const char* data, size_t size);
+
+    QStringList TakeLinks();
+
+    // anchor_texts receives the text of each link, empty when it has none
+    QStringList TakeLinks(QList<QByteArray>& anchor_texts);
+
+private:
+
+    enum class State
+    {
+        kText,
+        kTagOpen,
+        kTagName,
+        kMarkupDeclaration,
+        kEndTag,
+        kBeforeAttributeName,
+        kAttributeName,
+        kAfterAttributeName,
+        kBeforeAttributeValue,
+        kAttributeValueQuoted,
+        kAttributeValueUnquoted,
+        kComment,
+        kRawText
+    };
+
+    QUrl        base_url_ {};
+    bool        has_base_tag_ = false;
+    QStringList links_ {};
+
+    bool                keep_anchor_text_ = false;
+    QList<QByteArray>   anchor_texts_ {};
+    // Link added by the tag being parsed, and the link whose text is being read
+    int                 tag_link_ = -1;
+    int                 anchor_link_ = -1;
+
+    State       state_ = State::kText;
+    QByteArray  tag_name_ {};
+    QByteArray  attribute_name_ {};
+    QByteArray  attribute_value_ {};
+    char        quote_ = '"';
+    bool        is_link_attribute_ = false;
+
+    // Dashes seen in a comment or markup declaration, or progress
+    // through the closing tag of a script or style element
+    int         end_matched_ = 0;
+
+    void BeginAttribute(char byte);
+
+    void BeginAttributeValue();
+
+    void EndAttribute();
+
+    void EndTag();
+
+    void AddLink(const QByteArray& value);
+};
+
+#endif // LINKEXTRACTOR_H
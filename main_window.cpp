@@ -47,6 +47,12 @@ void MainWindow::startSearch()
         return;
     }
 
+    auto requests_count = ui_input.GetMaxRequests();
+    if (requests_count.isEmpty()) {
+        QMessageBox::critical(this, "Error", "Empty Max Requests field.");
+        return;
+    }
+
     auto search_text = ui_input.GetSearchText();
     if (search_text.isEmpty()) {
         QMessageBox::critical(this, "Error", "Empty Search Text field.");
@@ -65,6 +71,7 @@ void MainWindow::startSearch()
     ui_search.Start(
         start_url,
         threads_count.toUShort(),
+        requests_count.toUShort(),
         search_text,
         max_urls.toUInt()
     );
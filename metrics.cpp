@@ -0,0 +1,213 @@
+#include "metrics.h"
+
+#include <QtAlgorithms>
+
+#include <algorithm>
+
+static constexpr auto METRIC_PREFIX = "webcrawler_";
+
+// Bucket bounds of the exported histograms, in seconds
+static const std::vector<double> EXPORT_BUCKETS
+{
+    0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05,
+    0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60
+};
+
+static const std::array<const char*, METRIC_STAGE_COUNT> STAGE_NAMES
+{
+    "queue_wait", "connection_wait", "connect", "first_byte", "download", "match", "link_parse"
+};
+
+// Owner-only counters do not need an atomic read-modify-write
+static void addRelaxed(std::atomic<quint64>& counter, quint64 value)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+quint64 HistogramSnapshot::Percentile(double percentile) const
+{
+    if (count == 0) {
+        return 0;
+    }
+
+    auto rank {static_cast<quint64>(std::max(std::min(percentile, 1.0), 0.0) * (count - 1)) + 1};
+    quint64 seen {0};
+    for (size_t index = 0; index < buckets.size(); ++index) {
+        seen += buckets[index];
+        if (seen >= rank) {
+            return LatencyHistogram::BucketLimit(static_cast<int>(index));
+        }
+    }
+    return LatencyHistogram::BucketLimit(static_cast<int>(buckets.size()) - 1);
+}
+
+int LatencyHistogram::BucketIndex(quint64 ns)
+{
+    static constexpr quint64 SUB_BUCKETS = 1ull << SUB_BUCKET_BITS;
+
+    if (ns < SUB_BUCKETS) {
+        return static_cast<int>(ns);
+    }
+
+    ns = std::min<quint64>(ns, (1ull << MAX_VALUE_BITS) - 1);
+
+    // The top SUB_BUCKET_BITS + 1 bits pick the bucket, the rest is dropped
+    auto magnitude {63 - static_cast<int>(qCountLeadingZeroBits(ns)) - SUB_BUCKET_BITS};
+    return static_cast<int>((magnitude << SUB_BUCKET_BITS) + (ns >> magnitude));
+}
+
+quint64 LatencyHistogram::BucketLimit(int index)
+{
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+
+    if (index < 2 * SUB_BUCKETS) {
+        return static_cast<quint64>(index) + 1;
+    }
+
+    auto magnitude {(index >> SUB_BUCKET_BITS) - 1};
+    auto top {static_cast<quint64>(index - (magnitude << SUB_BUCKET_BITS))};
+    return (top + 1) << magnitude;
+}
+
+void LatencyHistogram::Record(qint64 ns)
+{
+    auto value {static_cast<quint64>(std::max<qint64>(ns, 0))};
+    addRelaxed(buckets_[BucketIndex(value)], 1);
+    addRelaxed(count_, 1);
+    addRelaxed(sum_ns_, value);
+}
+
+void LatencyHistogram::MergeInto(HistogramSnapshot& snapshot) const
+{
+    snapshot.buckets.resize(BUCKET_COUNT);
+    for (int index = 0; index < BUCKET_COUNT; ++index) {
+        snapshot.buckets[index] += buckets_[index].load(std::memory_order_relaxed);
+    }
+    snapshot.count += count_.load(std::memory_order_relaxed);
+    snapshot.sum_ns += sum_ns_.load(std::memory_order_relaxed);
+}
+
+MetricsShard::MetricsShard(int results_count) :
+    results_(std::max(results_count, 0))
+{
+
+}
+
+void MetricsShard::Record(MetricStage stage, qint64 ns)
+{
+    histograms_[static_cast<int>(stage)].Record(ns);
+}
+
+void MetricsShard::AddResult(int result)
+{
+    if (result >= 0 && result < static_cast<int>(results_.size())) {
+        addRelaxed(results_[result], 1);
+    }
+}
+
+CrawlMetrics::CrawlMetrics(int shards_count, const QStringList& result_names) :
+    result_names_ {result_names}
+{
+    for (int i = 0; i < shards_count; ++i) {
+        shards_.push_back(std::make_shared<MetricsShard>(result_names_.size()));
+    }
+}
+
+std::shared_ptr<MetricsShard> CrawlMetrics::Shard(int index) const
+{
+    return index >= 0 && index < static_cast<int>(shards_.size()) ? shards_[index] : nullptr;
+}
+
+MetricsSnapshot CrawlMetrics::Snapshot() const
+{
+    MetricsSnapshot snapshot;
+    std::vector<quint64> results(result_names_.size());
+
+    for (const auto& shard : shards_) {
+        for (int stage = 0; stage < METRIC_STAGE_COUNT; ++stage) {
+            shard->histograms_[stage].MergeInto(snapshot.stages[stage]);
+        }
+        for (size_t result = 0; result < results.size(); ++result) {
+            results[result] += shard->results_[result].load(std::memory_order_relaxed);
+        }
+    }
+
+    for (size_t result = 0; result < results.size(); ++result) {
+        if (results[result] > 0) {
+            snapshot.results.append(qMakePair(result_names_[static_cast<int>(result)], results[result]));
+            snapshot.pages += results[result];
+        }
+    }
+
+    return snapshot;
+}
+
+QString CrawlMetrics::StageName(MetricStage stage)
+{
+    return STAGE_NAMES[static_cast<int>(stage)];
+}
+
+QByteArray CrawlMetrics::ToPrometheusText(const MetricsSnapshot& snapshot)
+{
+    QByteArray text;
+    auto metric {[&text](const char* name, const char* type, const char* help) {
+        text.append("# HELP ").append(METRIC_PREFIX).append(name).append(' ').append(help).append('\n');
+        text.append("# TYPE ").append(METRIC_PREFIX).append(name).append(' ').append(type).append('\n');
+    }};
+    auto sample {[&text](const char* name, const QByteArray& labels, double value) {
+        text.append(METRIC_PREFIX).append(name);
+        if (!labels.isEmpty()) {
+            text.append('{').append(labels).append('}');
+        }
+        text.append(' ').append(QByteArray::number(value, 'g', 15)).append('\n');
+    }};
+
+    metric("stage_seconds", "histogram", "Time spent in each stage of a url fetch.");
+    for (int stage = 0; stage < METRIC_STAGE_COUNT; ++stage) {
+        const auto& histogram {snapshot.stages[stage]};
+        auto stage_label {QByteArray("stage=\"") + STAGE_NAMES[stage] + '"'};
+
+        // Buckets are counted up to the export bound their upper limit falls under
+        quint64 cumulative {0};
+        size_t index {0};
+        for (auto bound : EXPORT_BUCKETS) {
+            auto bound_ns {static_cast<quint64>(bound * 1e9)};
+            while (index < histogram.buckets.size() && LatencyHistogram::BucketLimit(static_cast<int>(index)) <= bound_ns) {
+                cumulative += histogram.buckets[index++];
+            }
+            sample("stage_seconds_bucket", stage_label + ",le=\"" + QByteArray::number(bound) + '"', cumulative);
+        }
+        sample("stage_seconds_bucket", stage_label + ",le=\"+Inf\"", histogram.count);
+        sample("stage_seconds_sum", stage_label, histogram.sum_ns / 1e9);
+        sample("stage_seconds_count", stage_label, histogram.count);
+    }
+
+    metric("pages_total", "counter", "Urls fetched to a final status.");
+    sample("pages_total", QByteArray(), snapshot.pages);
+
+    metric("results_total", "counter", "Urls by final status.");
+    for (const auto& result : snapshot.results) {
+        sample("results_total", "status=\"" + result.first.toUtf8() + '"', result.second);
+    }
+
+    metric("received_bytes_total", "counter", "Body bytes received, before decoding.");
+    sample("received_bytes_total", QByteArray(), snapshot.transfer.received_bytes);
+
+    metric("decoded_bytes_total", "counter", "Body bytes after decoding.");
+    sample("decoded_bytes_total", QByteArray(), snapshot.transfer.decoded_bytes);
+
+    metric("rewritten_urls_total", "counter", "Links rewritten into their canonical form.");
+    sample("rewritten_urls_total", QByteArray(), snapshot.canonical.rewritten);
+
+    metric("duplicate_urls_total", "counter", "Links only recognized as seen once canonical, fetches avoided.");
+    sample("duplicate_urls_total", QByteArray(), snapshot.canonical.duplicates);
+
+    metric("duplicate_pages_total", "counter", "Pages whose links were skipped as copies of a page crawled before.");
+    sample("duplicate_pages_total", "match=\"exact\"", snapshot.content.duplicates);
+    sample("duplicate_pages_total", "match=\"near\"", snapshot.content.near_duplicates);
+
+    metric("frontier_urls", "gauge", "Urls queued in the frontier.");
+    sample("frontier_urls", QByteArray(), snapshot.frontier_size);
+
+    return text;
+}
@@ -0,0 +1,129 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "content_decoder.h"
+#include "content_index.h"
+#include "url_canonicalizer.h"
+
+enum class MetricStage
+{
+    // Time a worker waited on the frontier for its next url
+    kQueueWait,
+    // From the request queued to its channel opening a new connection,
+    // time spent waiting for a free channel of the host
+    kConnectionWait,
+    // Name lookup, TCP connect and TLS handshake, Qt resolves the host
+    // from the socket once the channel starts connecting
+    kConnect,
+    // From the request sent, or from its start when Qt cannot tell, to the response headers
+    kFirstByte,
+    kDownload,
+    kMatch,
+    kLinkParse
+};
+
+static constexpr int METRIC_STAGE_COUNT = 7;
+
+struct HistogramSnapshot
+{
+    std::vector<quint64>    buckets {};
+    quint64                 count = 0;
+    quint64                 sum_ns = 0;
+
+    // Upper bound of the bucket holding the percentile, in ns
+    quint64 Percentile(double percentile) const;
+};
+
+// HDR-style histogram of nanosecond latencies: every power of two is split
+// into 16 linear sub-buckets, so a value is kept to within 1/16 of itself
+// from 1 ns up to about 18 minutes. Record is meant for a single writer,
+// readers merge it concurrently.
+class LatencyHistogram
+{
+public:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr int MAX_VALUE_BITS = 40;
+    static constexpr int BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS;
+
+    static int BucketIndex(quint64 ns);
+
+    // Exclusive upper bound of the values in the bucket
+    static quint64 BucketLimit(int index);
+
+    void Record(qint64 ns);
+
+    void MergeInto(HistogramSnapshot& snapshot) const;
+
+private:
+
+    std::array<std::atomic<quint64>, BUCKET_COUNT>  buckets_ {};
+    std::atomic<quint64>                            count_ {0};
+    std::atomic<quint64>                            sum_ns_ {0};
+};
+
+// Metrics recorded by one thread
+class MetricsShard
+{
+public:
+    explicit MetricsShard(int results_count);
+
+    void Record(MetricStage stage, qint64 ns);
+
+    void AddResult(int result);
+
+private:
+
+    friend class CrawlMetrics;
+
+    std::array<LatencyHistogram, METRIC_STAGE_COUNT>    histograms_ {};
+    std::vector<std::atomic<quint64>>                   results_;
+};
+
+struct MetricsSnapshot
+{
+    std::array<HistogramSnapshot, METRIC_STAGE_COUNT>   stages {};
+    // Final url statuses by name, pages are their sum
+    QList<QPair<QString, quint64>>                      results {};
+    quint64                                             pages = 0;
+    TransferStats                                       transfer {};
+    CanonicalStats                                      canonical {};
+    ContentStats                                        content {};
+    long                                                frontier_size = 0;
+};
+
+// Per-stage latencies and url results of a crawl. Every worker records
+// into its own shard without synchronization beyond relaxed atomics, the
+// shards are only summed up when a snapshot is taken.
+class CrawlMetrics
+{
+public:
+    // result_names names the values passed to MetricsShard::AddResult
+    CrawlMetrics(int shards_count, const QStringList& result_names);
+
+    std::shared_ptr<MetricsShard> Shard(int index) const;
+
+    MetricsSnapshot Snapshot() const;
+
+    static QString StageName(MetricStage stage);
+
+    // Prometheus text exposition format
+    static QByteArray ToPrometheusText(const MetricsSnapshot& snapshot);
+
+private:
+
+    QStringList                                 result_names_;
+    std::vector<std::shared_ptr<MetricsShard>>  shards_;
+};
+
+#endif // METRICS_H
@@ -0,0 +1,107 @@
+#include "metrics_exporter.h"
+
+#include <QDebug>
+#include <QSaveFile>
+
+#include <algorithm>
+
+static constexpr auto MAX_REQUEST_SIZE = 8 * 1024;
+
+MetricsExporter::MetricsExporter(const MetricsOptions& options, std::function<MetricsSnapshot()> TakeSnapshot) :
+    QObject {nullptr},
+    options_ {options},
+    TakeSnapshot_ {TakeSnapshot}
+{
+    connect(&server_, &QTcpServer::newConnection, this, [this]() {
+        OnNewConnection();
+    });
+    connect(&timer_, &QTimer::timeout, this, [this]() {
+        WriteFile();
+    });
+}
+
+bool MetricsExporter::Start()
+{
+    bool is_started {true};
+
+    if (options_.port != 0 && !server_.listen(QHostAddress::LocalHost, options_.port)) {
+        qWarning() << "Metrics: cannot listen on port" << options_.port << server_.errorString();
+        is_started = false;
+    }
+
+    if (!options_.file.isEmpty()) {
+        timer_.start(std::max(options_.interval, 100));
+    }
+
+    return is_started;
+}
+
+void MetricsExporter::WriteFile()
+{
+    if (options_.file.isEmpty()) {
+        return;
+    }
+
+    // Readers never see a file cut halfway
+    QSaveFile file {options_.file};
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Metrics: cannot write" << options_.file;
+        return;
+    }
+    file.write(CrawlMetrics::ToPrometheusText(TakeSnapshot_()));
+    file.commit();
+}
+
+// Private
+
+void MetricsExporter::OnNewConnection()
+{
+    while (server_.hasPendingConnections()) {
+        auto socket {server_.nextPendingConnection()};
+
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            OnReadyRead(socket);
+        });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            pending_input_.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void MetricsExporter::OnReadyRead(QTcpSocket* socket)
+{
+    auto& input {pending_input_[socket]};
+    input.append(socket->readAll());
+
+    auto end {input.indexOf("\r\n\r\n")};
+    if (end < 0) {
+        if (input.size() > MAX_REQUEST_SIZE) {
+            socket->abort();
+        }
+        return;
+    }
+
+    // One request per connection, answered and closed
+    auto parts {input.left(input.indexOf("\r\n")).split(' ')};
+    auto is_metrics {parts.size() >= 2 && parts[0] == "GET"
+                     && (parts[1] == "/metrics" || parts[1].startsWith("/metrics?"))};
+    input.clear();
+
+    QByteArray body;
+    QByteArray status {"404 Not Found"};
+    if (is_metrics) {
+        body = CrawlMetrics::ToPrometheusText(TakeSnapshot_());
+        status = "200 OK";
+    }
+
+    QByteArray response;
+    response.append("HTTP/1.1 ").append(status).append("\r\n");
+    response.append("Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n");
+    response.append("Content-Length: ").append(QByteArray::number(body.size())).append("\r\n");
+    response.append("Connection: close\r\n\r\n");
+    response.append(body);
+
+    socket->write(response);
+    socket->disconnectFromHost();
+}
@@ -0,0 +1,51 @@
+#ifndef METRICSEXPORTER_H
+#define METRICSEXPORTER_H
+
+#include <QObject>
+#include <QHash>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include <functional>
+
+#include "metrics.h"
+
+struct MetricsOptions
+{
+    // Local port serving GET /metrics in the Prometheus text format, 0 disables it
+    quint16 port = 0;
+    // File rewritten with the same text every interval, empty disables it
+    QString file {};
+    int     interval = 10000; // ms
+};
+
+// Publishes the metrics of a crawl from the thread it is created in
+class MetricsExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    MetricsExporter(const MetricsOptions& options, std::function<MetricsSnapshot()> TakeSnapshot);
+
+    bool Start();
+
+    // Writes the snapshot file now, the endpoint keeps serving
+    void WriteFile();
+
+private:
+
+    MetricsOptions  options_;
+    QTcpServer      server_ {};
+    QTimer          timer_ {};
+
+    QHash<QTcpSocket*, QByteArray>  pending_input_ {};
+
+    std::function<MetricsSnapshot()> TakeSnapshot_;
+
+    void OnNewConnection();
+
+    void OnReadyRead(QTcpSocket* socket);
+};
+
+#endif // METRICSEXPORTER_H
@@ -0,0 +1,117 @@
+#include "response_cache.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QUrl>
+
+#include "fingerprint.h"
+
+static constexpr quint32 CACHE_MAGIC = 0x57435243; // "WCRC"
+static constexpr quint32 CACHE_VERSION = 1;
+
+ResponseCache::ResponseCache(const CacheOptions& options) :
+    options_ {options}
+{
+    QDir().mkpath(options_.dir);
+}
+
+QString ResponseCache::NormalizedUrl(const QString& url)
+{
+    return QUrl(url).adjusted(QUrl::RemoveFragment | QUrl::NormalizePathSegments)
+            .toString(QUrl::FullyEncoded);
+}
+
+bool ResponseCache::Find(const QString& url, CachedResponse& response, bool with_body) const
+{
+    auto normalized_url {NormalizedUrl(url)};
+
+    QFile file {FilePath(normalized_url)};
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream {&file};
+    stream.setVersion(QDataStream::Qt_5_12);
+
+    quint32 magic {0};
+    quint32 version {0};
+    QString stored_url;
+    stream >> magic >> version >> stored_url;
+
+    // The stored url tells a fingerprint collision from a hit
+    if (magic != CACHE_MAGIC || version != CACHE_VERSION || stored_url != normalized_url) {
+        return false;
+    }
+
+    stream >> response.etag >> response.last_modified >> response.content_type;
+    if (with_body) {
+        stream >> response.body;
+    }
+
+    return stream.status() == QDataStream::Ok;
+}
+
+void ResponseCache::Store(const QString& url, const CachedResponse& response)
+{
+    auto normalized_url {NormalizedUrl(url)};
+    auto path {FilePath(normalized_url)};
+    QDir().mkpath(QFileInfo(path).path());
+
+    QSaveFile file {path};
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    QDataStream stream {&file};
+    stream.setVersion(QDataStream::Qt_5_12);
+    stream << CACHE_MAGIC << CACHE_VERSION << normalized_url
+           << response.etag << response.last_modified << response.content_type << response.body;
+
+    if (stream.status() == QDataStream::Ok) {
+        file.commit();
+    }
+    else {
+        file.cancelWriting();
+    }
+}
+
+bool ResponseCache::IsOffline() const
+{
+    return options_.offline;
+}
+
+void ResponseCache::AddHit()
+{
+    ++hits_;
+}
+
+void ResponseCache::AddMiss()
+{
+    ++misses_;
+}
+
+void ResponseCache::AddRevalidation()
+{
+    ++revalidations_;
+}
+
+CacheStats ResponseCache::Stats() const
+{
+    CacheStats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.revalidations = revalidations_;
+    return stats;
+}
+
+// Private
+
+QString ResponseCache::FilePath(const QString& normalized_url) const
+{
+    // Spread over 256 directories so none grows too large
+    auto name {QString("%1").arg(UrlFingerprint(normalized_url), 16, 16, QChar('0'))};
+    return QDir(options_.dir).filePath(name.left(2) + '/' + name);
+}
@@ -0,0 +1,71 @@
+#ifndef RESPONSECACHE_H
+#define RESPONSECACHE_H
+
+#include <QByteArray>
+#include <QString>
+
+#include <atomic>
+
+struct CacheOptions
+{
+    // Directory of the cached responses, empty disables the cache
+    QString dir {};
+    // Serve from the cache only, urls not cached fail without a request
+    bool    offline = false;
+};
+
+struct CacheStats
+{
+    // Bodies served from the cache, offline or after a 304 Not Modified
+    quint64 hits = 0;
+    // Bodies downloaded because nothing was cached or the page changed
+    quint64 misses = 0;
+    // Conditional requests sent for cached pages
+    quint64 revalidations = 0;
+};
+
+struct CachedResponse
+{
+    QByteArray  etag {};
+    QByteArray  last_modified {};
+    QByteArray  content_type {};
+    QByteArray  body {};
+};
+
+// On-disk cache of the fetched pages, one file per normalized url named
+// after its fingerprint. Files are replaced atomically, so workers can
+// read and write the cache concurrently without a lock.
+class ResponseCache
+{
+public:
+    explicit ResponseCache(const CacheOptions& options);
+
+    static QString NormalizedUrl(const QString& url);
+
+    // Reads the validators stored for url, and the body when with_body is set
+    bool Find(const QString& url, CachedResponse& response, bool with_body) const;
+
+    void Store(const QString& url, const CachedResponse& response);
+
+    bool IsOffline() const;
+
+    void AddHit();
+
+    void AddMiss();
+
+    void AddRevalidation();
+
+    CacheStats Stats() const;
+
+private:
+
+    CacheOptions options_;
+
+    std::atomic<quint64> hits_ {0};
+    std::atomic<quint64> misses_ {0};
+    std::atomic<quint64> revalidations_ {0};
+
+    QString FilePath(const QString& normalized_url) const;
+};
+
+#endif // RESPONSECACHE_H
@@ -1,6 +1,7 @@
 #include "search_engine.h"
 
 #include <QThread>
+#include <QTimer>
 #include <QDebug>
 
 #include <unordered_map>
@@ -22,14 +23,47 @@ static const std::unordered_map<WorkerResult, UrlSearchStatus> gStatusValues
     {WorkerResult::kErrorNetworkSessionFailed,      UrlSearchStatus::kErrorNetworkSessionFailed},
     {WorkerResult::kErrorUnknownNetwork,            UrlSearchStatus::kErrorUnknownNetwork},
     {WorkerResult::kErrorProtocolUnknown,           UrlSearchStatus::kErrorProtocolUnknown},
+    {WorkerResult::kErrorNotCached,                 UrlSearchStatus::kErrorNotCached},
     {WorkerResult::kErrorUnknown,                   UrlSearchStatus::kErrorUnknown}
 };
 
-template <typename T>
-static void clear(std::queue<T> &q )
+static const std::unordered_map<UrlSearchStatus, QString> gStatusNames
 {
-   std::queue<T> empty;
-   std::swap( q, empty );
+    {UrlSearchStatus::kProcess,                         "process"},
+    {UrlSearchStatus::kFound,                           "found"},
+    {UrlSearchStatus::kNotFound,                        "not_found"},
+    {UrlSearchStatus::kErrorTimeout,                    "error_timeout"},
+    {UrlSearchStatus::kErrorConnectionRefused,          "error_connection_refused"},
+    {UrlSearchStatus::kErrorRemoteHostClosed,           "error_remote_host_closed"},
+    {UrlSearchStatus::kErrorHostNotFound,               "error_host_not_found"},
+    {UrlSearchStatus::kErrorOperationCanceled,          "error_operation_canceled"},
+    {UrlSearchStatus::kErrorSslHandshakeFailed,         "error_ssl_handshake_failed"},
+    {UrlSearchStatus::kErrorTemporaryNetworkFailure,    "error_temporary_network_failure"},
+    {UrlSearchStatus::kErrorNetworkSessionFailed,       "error_network_session_failed"},
+    {UrlSearchStatus::kErrorUnknownNetwork,             "error_unknown_network"},
+    {UrlSearchStatus::kErrorProtocolUnknown,            "error_protocol_unknown"},
+    {UrlSearchStatus::kErrorNotCached,                  "error_not_cached"},
+    {UrlSearchStatus::kErrorUnknown,                    "error_unknown"}
+};
+
+UrlSearchStatus ToUrlSearchStatus(WorkerResult result)
+{
+    auto statusIt {gStatusValues.find(result)};
+    if (statusIt != gStatusValues.end()) {
+        return statusIt->second;
+    }
+
+    return UrlSearchStatus::kErrorUnknown;
+}
+
+QString ToStatusName(UrlSearchStatus status)
+{
+    auto statusIt {gStatusNames.find(status)};
+    if (statusIt != gStatusNames.end()) {
+        return statusIt->second;
+    }
+
+    return "error_unknown";
 }
 
 SearchEngine::SearchEngine() = default;
@@ -39,54 +73,160 @@ EngineStatus SearchEngine::GetStatus() const
     return status_;
 }
 
+double SearchEngine::GetSeenBytesPerUrl() const
+{
+    return frontier_.SeenBytesPerUrl();
+}
+
+ResolverStats SearchEngine::GetResolverStats() const
+{
+    return resolver_ ? resolver_->Stats() : ResolverStats {};
+}
+
+CacheStats SearchEngine::GetCacheStats() const
+{
+    return cache_ ? cache_->Stats() : CacheStats {};
+}
+
+TransferStats SearchEngine::GetTransferStats() const
+{
+    return transfer_ ? transfer_->Stats() : TransferStats {};
+}
+
+CanonicalStats SearchEngine::GetCanonicalStats() const
+{
+    return frontier_.GetCanonicalStats();
+}
+
+ContentStats SearchEngine::GetContentStats() const
+{
+    return content_ ? content_->Stats() : ContentStats {};
+}
+
+ClusterStats SearchEngine::GetClusterStats() const
+{
+    if (!cluster_) {
+        return ClusterStats {};
+    }
+
+    auto stats {cluster_->Stats()};
+    stats.suppressed = frontier_.GetSuppressedForwards();
+    return stats;
+}
+
+MetricsSnapshot SearchEngine::GetMetrics() const
+{
+    auto snapshot {metrics_ ? metrics_->Snapshot() : MetricsSnapshot {}};
+    snapshot.transfer = GetTransferStats();
+    snapshot.canonical = GetCanonicalStats();
+    snapshot.content = GetContentStats();
+    snapshot.frontier_size = frontier_.Size();
+    return snapshot;
+}
+
 void SearchEngine::Start(
     const QString& url_start,
     ushort threads_count,
-    const QString& search_text,
-    uint max_urls
+    ushort requests_per_thread,
+    const QStringList& search_terms,
+    uint max_urls,
+    const SearchOptions& options
 )
 {
     status_ = EngineStatus::kProcess;
 
-    auto setSearchStatus {[this](auto url, auto status) {
-        QMutexLocker locker(&status_mutex_);
-
-        auto statusIt {gStatusValues.find(status)};
-        if (statusIt != gStatusValues.end()) {
-            UpdateSearchStatus(url, statusIt->second);
-        }
-        else {
-            UpdateSearchStatus(url, UrlSearchStatus::kErrorUnknown);
-        }
-    }};
-
-    auto getSearchUrl {[this]() -> QString {
-        QMutexLocker locker(&queue_mutex_);
-
-        if (!urls_queue_.empty()) {
-            auto url = urls_queue_.front();
-            urls_queue_.pop();
-            return url;
-        }
+    // Compiled once per page charset, shared read-only by every worker
+    auto matchers {std::make_shared<TextMatcherCache>(search_terms, options.match)};
+    auto scorer {options.frontier.scheduler == SchedulerMode::kBestFirst
+                 ? std::make_shared<UrlScorer>(search_terms, options.frontier.priority)
+                 : nullptr};
+    resolver_ = std::make_shared<HostResolver>(options.resolver);
+    cache_ = options.cache.dir.isEmpty() ? nullptr : std::make_shared<ResponseCache>(options.cache);
+    content_ = options.content.enabled ? std::make_shared<ContentIndex>(options.content) : nullptr;
+    transfer_ = std::make_shared<TransferCounters>();
+
+    QStringList status_names;
+    for (int status = 0; status <= static_cast<int>(UrlSearchStatus::kErrorUnknown); ++status) {
+        status_names.append(ToStatusName(static_cast<UrlSearchStatus>(status)));
+    }
+    metrics_ = std::make_shared<CrawlMetrics>(threads_count, status_names);
+
+    metrics_exporter_.reset();
+    if (options.metrics.port != 0 || !options.metrics.file.isEmpty()) {
+        metrics_exporter_.reset(new MetricsExporter(options.metrics, [this]() {
+            return GetMetrics();
+        }));
+        metrics_exporter_->Start();
+    }
 
-        return nullptr;
-    }};
+    tracer_ = options.trace.file.isEmpty() ? nullptr : std::make_shared<Tracer>(options.trace);
+
+    auto frontier_options {options.frontier};
+    std::function<void(int, const QString&, const UrlHint&)> forwardUrl {nullptr};
+    cluster_.reset();
+    if (!options.cluster.name.isEmpty() && options.cluster.nodes > 1) {
+        cluster_.reset(new ClusterNode(options.cluster,
+            [this](const QString& url, const UrlHint& hint) {
+                frontier_.Push(url, -1, hint);
+            },
+            [this]() {
+                return frontier_.IsEmpty() && !IsWorkersProcessed();
+            },
+            [this]() {
+                return metrics_->Snapshot().pages;
+            },
+            [this](bool is_found) {
+                if (status_ != EngineStatus::kStop) {
+                    emit search_result(is_found ? SearchResult::kFound : SearchResult::kNotFound);
+                }
+            }));
+        frontier_options.partition = options.cluster.node;
+        frontier_options.partitions = options.cluster.nodes;
+        forwardUrl = [this](int node, const QString& url, const UrlHint& hint) {
+            cluster_->Forward(node, url, hint);
+        };
+    }
 
-    auto addSearchUrl {[this, max_urls](auto url) {
-        QMutexLocker locker(&queue_mutex_);
+    // Every node pushes the start url, the node owning its host crawls it
+    frontier_.Open(max_urls, threads_count, frontier_options, forwardUrl);
+    frontier_.Push(url_start);
 
-        if (checked_urls_.find(url) == checked_urls_.end()
-                && checked_urls_.size() < max_urls && status_ != EngineStatus::kStop) {
-            urls_queue_.push(url);
-            checked_urls_.insert(url);
-        }
-    }};
+    if (cluster_ && !cluster_->Start()) {
+        QTimer::singleShot(0, this, [this]() {
+            if (status_ != EngineStatus::kStop) {
+                emit search_result(SearchResult::kNotFound);
+            }
+        });
+    }
 
-    addSearchUrl(url_start);
     workers_.reserve(threads_count);
     for (int i = 0; i < threads_count; ++i)
     {
-        SearchWorker* worker = new SearchWorker(search_text,
+        // Each worker records into its own shard, from its own thread
+        auto shard {metrics_->Shard(i)};
+        auto trace {tracer_ ? tracer_->AddThread(QString("worker %1").arg(i)) : nullptr};
+
+        auto setSearchStatus {[this, shard, trace](auto url, auto status) {
+            SetWorkerStatus(url, status, shard, trace);
+        }};
+
+        auto getSearchUrl {[this, i](bool wait) -> QString {
+            return frontier_.Pop(i, wait);
+        }};
+
+        auto addSearchUrl {[this, i](auto url, auto hint) {
+            frontier_.Push(url, i, hint);
+        }};
+
+        SearchWorker* worker = new SearchWorker(matchers,
+                                                scorer,
+                                                resolver_,
+                                                cache_,
+                                                content_,
+                                                transfer_,
+                                                shard,
+                                                trace,
+                                                requests_per_thread,
                                                 setSearchStatus,
                                                 getSearchUrl,
                                                 addSearchUrl);
@@ -102,6 +242,16 @@ void SearchEngine::Start(
         thread->start();
         workers_.push_back(worker);
     }
+
+    // A resumed crawl may have nothing left to fetch, no status update would
+    // end it. A cluster node waits for the coordinator instead.
+    if (!cluster_ && frontier_.IsEmpty()) {
+        QTimer::singleShot(0, this, [this]() {
+            if (status_ != EngineStatus::kStop && frontier_.IsEmpty() && !IsWorkersProcessed()) {
+                emit search_result(SearchResult::kNotFound);
+            }
+        });
+    }
 }
 
 void SearchEngine::Pause()
@@ -109,6 +259,7 @@ void SearchEngine::Pause()
     QMutexLocker locker(&workers_mutex_);
 
     status_ = EngineStatus::kPause;
+    frontier_.Pause();
     for (auto worker : workers_) {
         worker->Pause();
     }
@@ -122,6 +273,7 @@ void SearchEngine::Resume()
     for (auto worker : workers_) {
         worker->Resume();
     }
+    frontier_.Resume();
 }
 
 void SearchEngine::Stop()
@@ -133,16 +285,24 @@ void SearchEngine::Stop()
         worker->Stop();
     }
     workers_.clear();
+    frontier_.Stop();
+
+    if (cluster_) {
+        cluster_->Close();
+    }
+    if (metrics_exporter_) {
+        metrics_exporter_->WriteFile();
+    }
+    if (tracer_) {
+        tracer_->Write();
+    }
 
     Reset();
 }
 
 void SearchEngine::Reset()
 {
-    QMutexLocker locker(&queue_mutex_);
-
-    clear(urls_queue_);
-    checked_urls_.clear();
+    frontier_.Clear();
 }
 
 bool SearchEngine::IsWorkersProcessed()
@@ -158,6 +318,32 @@ bool SearchEngine::IsWorkersProcessed()
     return false;
 }
 
+void SearchEngine::SetWorkerStatus(
+    const QString& url,
+    WorkerResult status,
+    const std::shared_ptr<MetricsShard>& shard,
+    const std::shared_ptr<TraceBuffer>& trace
+)
+{
+    auto url_status {ToUrlSearchStatus(status)};
+    if (status != WorkerResult::kProcess) {
+        frontier_.Complete(url);
+        shard->AddResult(static_cast<int>(url_status));
+    }
+
+    // Time blocked behind the other workers' updates shows as its own span
+    auto lock_started_at {trace ? trace->Now() : 0};
+    QMutexLocker locker(&status_mutex_);
+    auto locked_at {trace ? trace->Now() : 0};
+
+    UpdateSearchStatus(url, url_status);
+
+    if (trace) {
+        trace->AddSpan("status_lock", lock_started_at, locked_at);
+        trace->AddSpan("emit_status", locked_at, trace->Now());
+    }
+}
+
 void SearchEngine::UpdateSearchStatus(
     const QString& url,
     UrlSearchStatus status
@@ -170,10 +356,15 @@ void SearchEngine::UpdateSearchStatus(
     emit update_url_status(url, status);
 
     if (status == UrlSearchStatus::kFound) {
+        // The coordinator stops the other nodes
+        if (cluster_) {
+            cluster_->ReportFound(url);
+        }
         emit search_result(SearchResult::kFound);
     }
-    else if (status_ != EngineStatus::kStop && status != UrlSearchStatus::kProcess) {
-        if (!IsWorkersProcessed() && urls_queue_.empty()) {
+    // Only the coordinator knows when every node ran out of urls
+    else if (!cluster_ && status_ != EngineStatus::kStop && status != UrlSearchStatus::kProcess) {
+        if (!IsWorkersProcessed() && frontier_.IsEmpty()) {
             emit search_result(SearchResult::kNotFound);
         }
     }
@@ -4,8 +4,15 @@
 #include <QObject>
 #include <QMutex>
 
-#include <set>
-#include <queue>
+#include "cluster_node.h"
+#include "content_decoder.h"
+#include "content_index.h"
+#include "host_resolver.h"
+#include "metrics_exporter.h"
+#include "response_cache.h"
+#include "text_matcher.h"
+#include "trace.h"
+#include "url_frontier.h"
 
 enum class UrlSearchStatus
 {
@@ -22,6 +29,7 @@ enum class UrlSearchStatus
     kErrorNetworkSessionFailed,
     kErrorUnknownNetwork,
     kErrorProtocolUnknown,
+    kErrorNotCached,
     kErrorUnknown
 };
 
@@ -38,8 +46,28 @@ enum class SearchResult
     kNotFound
 };
 
+struct SearchOptions
+{
+    FrontierOptions frontier {};
+    MatchOptions    match {};
+    ResolverOptions resolver {};
+    CacheOptions    cache {};
+    ContentOptions  content {};
+    MetricsOptions  metrics {};
+    TraceOptions    trace {};
+    // Crawls one partition of the hosts as a node of a cluster when named
+    ClusterOptions  cluster {};
+};
+
 class SearchWorker;
 
+enum class WorkerResult;
+
+UrlSearchStatus ToUrlSearchStatus(WorkerResult result);
+
+// Lower case name of the status, as printed by the CLI and exported in the metrics
+QString ToStatusName(UrlSearchStatus status);
+
 class SearchEngine : public QObject
 {
     Q_OBJECT
@@ -49,11 +77,36 @@ public:
 
     EngineStatus GetStatus() const;
 
+    // Memory held by the seen-url set divided by the urls admitted so far
+    double GetSeenBytesPerUrl() const;
+
+    // Lookups of the last started search
+    ResolverStats GetResolverStats() const;
+
+    CacheStats GetCacheStats() const;
+
+    // Body bytes of the last started search, before and after decoding
+    TransferStats GetTransferStats() const;
+
+    // Links of the last started search rewritten or dropped by the canonicalizer
+    CanonicalStats GetCanonicalStats() const;
+
+    // Pages of the last started search whose links were skipped as copies
+    ContentStats GetContentStats() const;
+
+    // Urls of the last started search exchanged with the other nodes of its cluster
+    ClusterStats GetClusterStats() const;
+
+    // Stage latencies and url results of the last started search
+    MetricsSnapshot GetMetrics() const;
+
     void Start(
         const QString& url_start,
         ushort threads_count,
-        const QString& search_text,
-        uint max_urls
+        ushort requests_per_thread,
+        const QStringList& search_terms,
+        uint max_urls,
+        const SearchOptions& options = SearchOptions {}
     );
 
     void Pause();
@@ -69,14 +122,25 @@ signals:
 
 private:
 
+    // Drives the status path of the workers from the microbenchmarks
+    friend class StatusPathBenchmark;
+
     EngineStatus status_ = EngineStatus::kStop;
 
-    std::queue<QString> urls_queue_ {};
-    std::set<QString>   checked_urls_ {};
+    UrlFrontier frontier_ {};
+
+    std::shared_ptr<HostResolver>       resolver_ {};
+    std::shared_ptr<ResponseCache>      cache_ {};
+    std::shared_ptr<ContentIndex>       content_ {};
+    std::shared_ptr<TransferCounters>   transfer_ {};
+    std::shared_ptr<CrawlMetrics>       metrics_ {};
+    std::unique_ptr<MetricsExporter>    metrics_exporter_ {};
+    std::shared_ptr<Tracer>             tracer_ {};
+    // Kept closed after Stop, a worker winding down may still forward a url
+    std::unique_ptr<ClusterNode>        cluster_ {};
 
     std::vector<SearchWorker*>  workers_ {};
 
-    QMutex queue_mutex_;
     QMutex workers_mutex_;
     QMutex status_mutex_;
 
@@ -84,6 +148,14 @@ private:
 
     bool IsWorkersProcessed();
 
+    // Status of a url reported by a worker, counted in its shard and emitted
+    void SetWorkerStatus(
+        const QString& url,
+        WorkerResult status,
+        const std::shared_ptr<MetricsShard>& shard,
+        const std::shared_ptr<TraceBuffer>& trace
+    );
+
     void UpdateSearchStatus(const QString& url, UrlSearchStatus status);
 
 };
@@ -1,18 +1,22 @@
 #include "search_window.h"
 #include "./ui_search_window.h"
 
+#include <QDateTime>
+#include <QDir>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QMessageBox>
+#include <QStandardPaths>
 
+#include <algorithm>
 #include <unordered_map>
 
 #include "search_engine.h"
 
-static constexpr auto       TABLE_COLUMN_COUNT = 3;
-static const QStringList    TABLE_COLUMN_HEADER = QStringList {"URL", "Status", "Result"};
-
-static constexpr auto TABLE_COLUMN_URL = 0;
-static constexpr auto TABLE_COLUMN_STATUS = 1;
-static constexpr auto TABLE_COLUMN_RESULT = 2;
+// Status updates reach the table at most 30 times a second
+static constexpr auto TABLE_UPDATE_INTERVAL = 33; // ms
+// Newest finished rows shown besides the matches, the errors and the urls in process
+static constexpr auto TABLE_RECENT_ROWS = 1000;
 
 static const QString PROGRESS_BAR_STYLE_PROCESS     = "QProgressBar::chunk { background-color: #0017FF; width: 20px;}";
 static const QString PROGRESS_BAR_STYLE_FOUND       = "QProgressBar::chunk { background-color: #60D811; width: 20px;}";
@@ -30,12 +34,14 @@ static const std::unordered_map<UrlSearchStatus, QString> gErrorStatusMessages
     {UrlSearchStatus::kErrorNetworkSessionFailed,       "Network Session Failed"},
     {UrlSearchStatus::kErrorUnknownNetwork,             "Unknown Network Error"},
     {UrlSearchStatus::kErrorProtocolUnknown,            "Unknown Protocol Error"},
+    {UrlSearchStatus::kErrorNotCached,                  "Not Cached"},
     {UrlSearchStatus::kErrorUnknown,                    "Unknown Error"}
 };
 
 SearchWindow::SearchWindow(QWidget *parent) :
     QWidget(parent),
-    ui(new Ui::SearchWindow)
+    ui(new Ui::SearchWindow),
+    table_model_ {TABLE_RECENT_ROWS}
 {
     ui->setupUi(this);
     setFixedSize(size());
@@ -49,10 +55,13 @@ SearchWindow::SearchWindow(QWidget *parent) :
             this, &SearchWindow::on_tableUpdate);
     connect(&engine_, &SearchEngine::search_result,
             this, &SearchWindow::on_searchResult);
+    connect(&table_timer_, &QTimer::timeout,
+            this, &SearchWindow::on_tableFlush);
 }
 
 SearchWindow::~SearchWindow()
 {
+    FlushTable();
     delete ui;
 }
 
@@ -92,12 +101,12 @@ void SearchWindow::on_tableUpdate(const QString& url, UrlSearchStatus url_status
     }
 
     if (url_status != UrlSearchStatus::kProcess) {
-        UpdateProgressBar();
+        ++pending_progress_;
     }
 
     switch (url_status) {
     case UrlSearchStatus::kFound:
-        UpdateTable(url, Qt::CheckState::Checked, "Found", QColor(Qt::green));
+        UpdateTable(url, Qt::CheckState::Checked, "Found", QColor(Qt::green), true);
         break;
     case UrlSearchStatus::kProcess:
         UpdateTable(url, Qt::CheckState::PartiallyChecked, "Process", QColor(Qt::blue));
@@ -115,25 +124,27 @@ void SearchWindow::on_tableUpdate(const QString& url, UrlSearchStatus url_status
     case UrlSearchStatus::kErrorNetworkSessionFailed:
     case UrlSearchStatus::kErrorUnknownNetwork:
     case UrlSearchStatus::kErrorProtocolUnknown:
+    case UrlSearchStatus::kErrorNotCached:
     case UrlSearchStatus::kErrorUnknown:
     {
         auto statusIt {gErrorStatusMessages.find(url_status)};
         if (statusIt != gErrorStatusMessages.end()) {
-            UpdateTable(url, Qt::CheckState::Checked, statusIt->second, QColor(Qt::red));
+            UpdateTable(url, Qt::CheckState::Checked, statusIt->second, QColor(Qt::red), true);
         }
         else {
-            UpdateTable(url, Qt::CheckState::Checked, "Unknown Error", QColor(Qt::red));
+            UpdateTable(url, Qt::CheckState::Checked, "Unknown Error", QColor(Qt::red), true);
         }
         break;
     }
     default:
-        UpdateTable(url, Qt::CheckState::Checked, "Unknown Error", QColor(Qt::red));
+        UpdateTable(url, Qt::CheckState::Checked, "Unknown Error", QColor(Qt::red), true);
         break;
     }
 }
 
 void SearchWindow::on_searchResult(SearchResult result)
 {
+    FlushTable();
     UpdateProgressBarToMax();
     StopEngine();
 
@@ -148,19 +159,28 @@ void SearchWindow::on_searchResult(SearchResult result)
     }
 }
 
+void SearchWindow::on_tableFlush()
+{
+    FlushTable();
+}
+
 void SearchWindow::Start(
     const QString& url_start,
     ushort threads_count,
+    ushort requests_per_thread,
     const QString& search_text,
     uint max_urls
 )
 {
     SetProgressBarMax(max_urls);
+    OpenResultsFile();
+    table_timer_.start(TABLE_UPDATE_INTERVAL);
 
     engine_.Start(
         url_start,
         threads_count,
-        search_text,
+        requests_per_thread,
+        QStringList {search_text},
         max_urls
     );
 }
@@ -199,62 +219,86 @@ void SearchWindow::FinishEngine()
 
 void SearchWindow::InitTable()
 {
-    ui->urlTableWidget->setColumnCount(TABLE_COLUMN_COUNT);
-    ui->urlTableWidget->setHorizontalHeaderLabels(TABLE_COLUMN_HEADER);
-    ui->urlTableWidget->horizontalHeader()->setSectionResizeMode(TABLE_COLUMN_URL, QHeaderView::Stretch);
-    ui->urlTableWidget->setSelectionMode(QAbstractItemView::NoSelection);
+    ui->urlTableView->setModel(&table_model_);
+    ui->urlTableView->horizontalHeader()->setSectionResizeMode(UrlTableModel::kColumnUrl, QHeaderView::Stretch);
+    ui->urlTableView->setSelectionMode(QAbstractItemView::NoSelection);
 }
 
 void SearchWindow::UpdateTable(
     const QString& url,
     Qt::CheckState state,
     const QString& status,
-    QColor color
+    QColor color,
+    bool is_kept
 )
 {
-    int table_id {0};
-    bool found {false};
+    table_model_.Update(url, state, status, color, is_kept);
+
+    if (results_file_.isOpen()) {
+        results_buffer_.append(QJsonDocument(QJsonObject {
+            {"url",         url},
+            {"status",      status},
+            {"elapsed_ms",  results_elapsed_.elapsed()}
+        }).toJson(QJsonDocument::Compact));
+        results_buffer_.append('\n');
+    }
+}
 
-    int rows = ui->urlTableWidget->rowCount();
-    for(int i = 0; i < rows; ++i)
-    {
-        if(ui->urlTableWidget->item(i, TABLE_COLUMN_URL)->text() == url) {
-            found = true;
-            table_id = i;
-            break;
-        }
+void SearchWindow::FlushTable()
+{
+    if (table_model_.Flush() > 0) {
+        ui->urlTableView->scrollToBottom();
     }
 
-    if(!found)
-    {
-        table_id = current_records_num_++;
-        ui->urlTableWidget->insertRow(table_id);
+    if (pending_progress_ > 0) {
+        UpdateProgressBar(pending_progress_);
+        pending_progress_ = 0;
     }
 
-    // Url column
-    QTableWidgetItem *itemUrl = new QTableWidgetItem(url);
-    ui->urlTableWidget->setItem(table_id, TABLE_COLUMN_URL, itemUrl);
+    if (!results_buffer_.isEmpty()) {
+        results_file_.write(results_buffer_);
+        results_buffer_.clear();
+    }
+
+    UpdateSummary();
+}
 
-    // Status column
-    QTableWidgetItem *itemStatus = new QTableWidgetItem();
-    itemStatus->setFlags(Qt::ItemIsSelectable|Qt::ItemIsEnabled);
-    itemStatus->data(Qt::CheckStateRole);
-    itemStatus->setCheckState(state);
-    ui->urlTableWidget->setItem(table_id, TABLE_COLUMN_STATUS, itemStatus);
+void SearchWindow::ResetTable()
+{
+    table_timer_.stop();
+    table_model_.Clear();
+    pending_progress_ = 0;
+
+    results_buffer_.clear();
+    results_file_.close();
+    ui->summaryLabel->clear();
+    ui->summaryLabel->setToolTip(QString());
+}
 
-    // Result column
-    QTableWidgetItem *itemResult = new QTableWidgetItem(status);
-    itemResult->setForeground(QBrush(color));
-    ui->urlTableWidget->setItem(table_id, TABLE_COLUMN_RESULT, itemResult);
+void SearchWindow::OpenResultsFile()
+{
+    // Every status goes to the file, the table only keeps a window of them
+    QDir dir {QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)};
+    dir.mkpath("results");
+
+    results_file_.close();
+    results_file_.setFileName(dir.filePath(QString("results/%1.jsonl")
+                                           .arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"))));
+    if (!results_file_.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Cannot write" << results_file_.fileName();
+    }
+    results_elapsed_.start();
 
-    ui->urlTableWidget->scrollToBottom();
+    ui->summaryLabel->setToolTip(results_file_.isOpen() ? results_file_.fileName() : QString());
 }
 
-void SearchWindow::ResetTable()
+void SearchWindow::UpdateSummary()
 {
-    current_records_num_ = 0;
-    ui->urlTableWidget->clear();
-    ui->urlTableWidget->setRowCount(0);
+    QStringList totals;
+    for (const auto& total : table_model_.Totals()) {
+        totals.append(QString("%1: %2").arg(total.first).arg(total.second));
+    }
+    ui->summaryLabel->setText(totals.join("   "));
 }
 
 void SearchWindow::InitProgressBar()
@@ -275,10 +319,10 @@ void SearchWindow::SetProgressBarStyle(const QString& style)
     ui->progressBar->setStyleSheet(style);
 }
 
-void SearchWindow::UpdateProgressBar()
+void SearchWindow::UpdateProgressBar(int count)
 {
-    auto value = ui->progressBar->value();
-    if (++value != ui->progressBar->maximum())
+    auto value = std::min(ui->progressBar->value() + count, ui->progressBar->maximum() - 1);
+    if (value > ui->progressBar->value())
         ui->progressBar->setValue(value);
 }
 
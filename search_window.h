@@ -1,9 +1,13 @@
 #ifndef SEARCH_WINDOW_H
 #define SEARCH_WINDOW_H
 
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTimer>
 #include <QWidget>
 
 #include "search_engine.h"
+#include "url_table_model.h"
 
 namespace Ui {
 class SearchWindow;
@@ -20,6 +24,7 @@ public:
     void Start(
         const QString& url_start,
         ushort threads_count,
+        ushort requests_per_thread,
         const QString& search_text,
         uint max_urls
     );
@@ -40,10 +45,20 @@ private slots:
 
     void on_searchResult(SearchResult result);
 
+    void on_tableFlush();
+
 private:
     Ui::SearchWindow *ui;
 
-    unsigned int current_records_num_ = 0;
+    UrlTableModel   table_model_;
+    QTimer          table_timer_ {};
+    // Urls done since the last flush, added to the progress bar with it
+    int             pending_progress_ = 0;
+
+    // Full record of the statuses, written out at every flush
+    QFile           results_file_ {};
+    QByteArray      results_buffer_ {};
+    QElapsedTimer   results_elapsed_ {};
 
     SearchEngine engine_ {};
 
@@ -56,13 +71,17 @@ private:
     void UpdateTable(const QString& url,
                      Qt::CheckState state,
                      const QString& status,
-                     QColor color);
+                     QColor color,
+                     bool is_kept = false);
+    void FlushTable();
     void ResetTable();
+    void OpenResultsFile();
+    void UpdateSummary();
 
     void InitProgressBar();
     void SetProgressBarMax(int max_value);
     void SetProgressBarStyle(const QString& style);
-    void UpdateProgressBar();
+    void UpdateProgressBar(int count);
     void UpdateProgressBarToMax();
     void ResetProgressBar();
 };
@@ -1,108 +1,515 @@
 #include "search_worker.h"
 
-#include <QRegularExpression>
+#include <algorithm>
+#include <cstring>
 
 static constexpr auto CONNECTION_TIMEOUT = 5000; // ms
+static constexpr auto READ_BUFFER_SIZE = 64 * 1024;
+static constexpr auto CHARSET_SNIFF_SIZE = 1024;
+
+static QByteArray parseCharset(const QByteArray& text)
+{
+    auto index {text.toLower().indexOf("charset=")};
+    if (index < 0) {
+        return QByteArray();
+    }
+
+    index += 8;
+    while (index < text.size() && (text[index] == '"' || text[index] == '\'' || text[index] == ' ')) {
+        ++index;
+    }
+
+    auto end {index};
+    while (end < text.size() && !std::strchr("\"'; \t\r\n>/", text[end])) {
+        ++end;
+    }
+
+    return text.mid(index, end - index);
+}
+
+// Charset from the Content-Type header, or from a <meta> tag at the start of the body
+static QByteArray detectCharset(const QByteArray& content_type, const char* data, qint64 size)
+{
+    auto charset {parseCharset(content_type)};
+    if (charset.isEmpty() && size > 0) {
+        charset = parseCharset(QByteArray::fromRawData(data, std::min<qint64>(size, CHARSET_SNIFF_SIZE)));
+    }
+    return charset;
+}
 
 SearchWorker::SearchWorker(
-        QString search_text,
+        std::shared_ptr<TextMatcherCache>                   matchers,
+        std::shared_ptr<UrlScorer>                          scorer,
+        std::shared_ptr<HostResolver>                       resolver,
+        std::shared_ptr<ResponseCache>                      cache,
+        std::shared_ptr<ContentIndex>                       content,
+        std::shared_ptr<TransferCounters>                   transfer,
+        std::shared_ptr<MetricsShard>                       metrics,
+        std::shared_ptr<TraceBuffer>                        trace,
+        ushort max_requests,
         std::function<void(const QString&, WorkerResult)>   SetSearchStatus,
-        std::function<QString()>                            GetSearchedUrl,
-        std::function<void(const QString&)>                 AddSearchedUrl
+        std::function<QString(bool)>                        GetSearchedUrl,
+        std::function<void(const QString&, const UrlHint&)> AddSearchedUrl
 ) : QObject {nullptr},
-    search_text_ {search_text},
+    matchers_ {matchers},
+    scorer_ {scorer},
+    resolver_ {resolver},
+    cache_ {cache},
+    content_ {content},
+    transfer_ {transfer},
+    metrics_ {metrics},
+    trace_ {trace},
+    read_buffer_(READ_BUFFER_SIZE),
+    decode_buffer_(READ_BUFFER_SIZE),
+    max_requests_ {std::max<ushort>(max_requests, 1)},
     SetSearchStatus_{SetSearchStatus},
     GetSearchedUrl_{GetSearchedUrl},
     AddSearchedUrl_{AddSearchedUrl}
 {
-
+    if (trace_) {
+        clock_ = trace_->Clock();
+    }
+    else {
+        clock_.start();
+    }
 }
 
 SearchWorker::~SearchWorker() = default;
 
 void SearchWorker::Start()
 {
-    while (state_ != State::kStopped) {
+    // One manager per worker, so its connection pool survives between fetches
+    manager_ = new QNetworkAccessManager(this);
+
+    Dispatch();
+}
+
+void SearchWorker::Pause()
+{
+    state_ = State::kPaused;
+}
+
+void SearchWorker::Resume()
+{
+    state_ = State::kRunning;
+}
+
+void SearchWorker::Stop()
+{
+    // Wake the worker thread before the state change, the worker
+    // may finish and be deleted as soon as it observes kStopped
+    QMetaObject::invokeMethod(this, "Dispatch", Qt::QueuedConnection);
+    state_ = State::kStopped;
+}
+
+bool SearchWorker::IsProcessed() const
+{
+    return requests_in_flight_ > 0;
+}
+
+// Private slots
+
+void SearchWorker::Dispatch()
+{
+    if (is_finished_) {
+        return;
+    }
+
+    if (state_ == State::kStopped) {
+        Finish();
+        return;
+    }
+
+    while (requests_.size() < max_requests_) {
+        // Park on the frontier only when no completion is left to drive the next dispatch
+        auto pop_started_at {clock_.nsecsElapsed()};
+        auto url {GetSearchedUrl_(requests_.empty())};
+        if (state_ == State::kStopped) {
+            Finish();
+            return;
+        }
+        if (url == nullptr) {
+            break;
+        }
+        auto popped_at {clock_.nsecsElapsed()};
+        Record(MetricStage::kQueueWait, popped_at - pop_started_at);
+        Trace("queue_wait", pop_started_at, popped_at);
+        ++requests_in_flight_;
+        Fetch(url);
+    }
+
+    if (requests_.empty()) {
+        QTimer::singleShot(0, this, SLOT(Dispatch()));
+    }
+}
+
+// Private
+
+void SearchWorker::Fetch(const QString& url)
+{
+    SetSearchStatus_(url, WorkerResult::kProcess);
+
+    QUrl page_url {url};
+    Request request;
+    request.url = url;
+    request.links = LinkExtractor(page_url, scorer_ != nullptr);
+    request.started_at = clock_.nsecsElapsed();
+
+    QNetworkRequest network_request {page_url};
+    // Set by hand, so the reply arrives still encoded and is decoded chunk by chunk
+    network_request.setRawHeader("Accept-Encoding", ContentDecoder::AcceptEncoding());
+    if (cache_) {
+        CachedResponse cached;
+        auto is_cached {cache_->Find(url, cached, cache_->IsOffline())};
 
-        if (state_ == State::kPaused) {
-            continue;
+        if (cache_->IsOffline()) {
+            if (is_cached) {
+                ProcessCached(request, cached);
+            }
+            else {
+                cache_->AddMiss();
+                --requests_in_flight_;
+                SetSearchStatus_(url, WorkerResult::kErrorNotCached);
+            }
+            return;
         }
 
-        auto url {GetSearchedUrl_()};
-        if (url != nullptr) {
-            is_proccessed_ = true;
-            SetSearchStatus_(url, WorkerResult::kProcess);
+        // The server answers 304 Not Modified while the cached copy is current
+        if (is_cached && !(cached.etag.isEmpty() && cached.last_modified.isEmpty())) {
+            if (!cached.etag.isEmpty()) {
+                network_request.setRawHeader("If-None-Match", cached.etag);
+            }
+            if (!cached.last_modified.isEmpty()) {
+                network_request.setRawHeader("If-Modified-Since", cached.last_modified);
+            }
+            request.is_revalidating = true;
+            cache_->AddRevalidation();
+        }
+        else {
+            cache_->AddMiss();
+        }
+    }
 
-            QTimer timer;
-            timer.setSingleShot(true);
-            QNetworkAccessManager manager;
-            QEventLoop event;
+    if (resolver_ && resolver_->IsNotFound(page_url.host())) {
+        --requests_in_flight_;
+        SetSearchStatus_(url, WorkerResult::kErrorHostNotFound);
+        return;
+    }
+
+    auto reply {manager_->get(network_request)};
+    requests_.emplace(reply, std::move(request));
 
-            auto reply = manager.get(QNetworkRequest(QUrl(url)));
+    connect(reply, &QNetworkReply::metaDataChanged, this, [this, reply]() {
+        auto requestIt {requests_.find(reply)};
+        if (requestIt != requests_.end() && requestIt->second.first_byte_at < 0) {
+            requestIt->second.first_byte_at = clock_.nsecsElapsed();
+        }
+    });
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+    // Only sent for a new connection, a pooled one skips the lookup and the connect
+    connect(reply, &QNetworkReply::socketStartedConnecting, this, [this, reply]() {
+        auto requestIt {requests_.find(reply)};
+        if (requestIt != requests_.end()) {
+            requestIt->second.connecting_at = clock_.nsecsElapsed();
+        }
+    });
+    connect(reply, &QNetworkReply::requestSent, this, [this, reply]() {
+        auto requestIt {requests_.find(reply)};
+        if (requestIt != requests_.end()) {
+            requestIt->second.sent_at = clock_.nsecsElapsed();
+        }
+    });
+#endif
+    connect(reply, &QNetworkReply::readyRead, this, [this, reply]() {
+        OnReplyReadyRead(reply);
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        OnReplyFinished(reply);
+    });
 
-            connect(&timer, SIGNAL(timeout()), &event, SLOT(quit()));
-            connect(reply, SIGNAL(finished()), &event, SLOT(quit()));
-            connect(reply, SIGNAL(finished()), &event, SLOT(deleteLater()));
+    QTimer::singleShot(CONNECTION_TIMEOUT, reply, [this, reply]() {
+        auto requestIt {requests_.find(reply)};
+        if (requestIt != requests_.end()) {
+            requestIt->second.timed_out = true;
+            reply->abort();
+        }
+    });
+}
+
+void SearchWorker::Finish()
+{
+    is_finished_ = true;
+
+    for (auto& request : requests_) {
+        request.first->disconnect(this);
+        request.first->abort();
+        request.first->deleteLater();
+    }
+    requests_.clear();
+    requests_in_flight_ = 0;
 
-            timer.start(CONNECTION_TIMEOUT);
-            event.exec();
+    emit finished();
+}
+
+void SearchWorker::Record(MetricStage stage, qint64 ns)
+{
+    if (metrics_) {
+        metrics_->Record(stage, ns);
+    }
+}
+
+void SearchWorker::RecordTimings(const Request& request)
+{
+    auto finished_at {clock_.nsecsElapsed()};
+
+    // Requests of a worker overlap, their spans do not nest
+    if (trace_) {
+        trace_->AddAsyncSpan("fetch", request.started_at, finished_at);
+    }
 
-            if(timer.isActive()) {
-                timer.stop();
-                auto error = reply->error();
-                if (error == QNetworkReply::NoError) {
-                    QString data = reply->readAll();
-                    ProcessReply(url, data);
+    if (request.connecting_at >= 0) {
+        Record(MetricStage::kConnectionWait, request.connecting_at - request.started_at);
+        if (request.sent_at >= 0) {
+            Record(MetricStage::kConnect, request.sent_at - request.connecting_at);
+        }
+    }
+    if (request.first_byte_at >= 0) {
+        // Without requestSent the wait includes the lookup and the connect
+        auto sent_at {request.sent_at >= 0 ? request.sent_at : request.started_at};
+        Record(MetricStage::kFirstByte, request.first_byte_at - sent_at);
+        Record(MetricStage::kDownload, finished_at - request.first_byte_at);
+    }
+}
+
+void SearchWorker::Trace(const char* name, qint64 start, qint64 end)
+{
+    if (trace_) {
+        trace_->AddSpan(name, start, end);
+    }
+}
+
+void SearchWorker::OnReplyReadyRead(QNetworkReply* reply)
+{
+    auto requestIt {requests_.find(reply)};
+    if (requestIt == requests_.end() || reply->error() != QNetworkReply::NoError) {
+        return;
+    }
+
+    // The rest of the body is not needed once the text is found
+    if (ReadChunk(requestIt->second, reply)) {
+        reply->abort();
+    }
+}
+
+void SearchWorker::OnReplyFinished(QNetworkReply* reply)
+{
+    auto requestIt {requests_.find(reply)};
+    if (requestIt == requests_.end()) {
+        return;
+    }
+
+    auto request {std::move(requestIt->second)};
+    requests_.erase(requestIt);
+    reply->deleteLater();
+
+    RecordTimings(request);
+
+    if (request.is_found) {
+        ProcessReply(request);
+    }
+    else if (request.timed_out) {
+        --requests_in_flight_;
+        SetSearchStatus_(request.url, WorkerResult::kErrorTimeout);
+    }
+    else if (request.is_corrupt) {
+        --requests_in_flight_;
+        SetSearchStatus_(request.url, WorkerResult::kErrorUnknown);
+    }
+    else {
+        auto error = reply->error();
+        auto status_code {reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt()};
+        CachedResponse cached;
+
+        if (error == QNetworkReply::NoError && request.is_revalidating && status_code == 304) {
+            if (cache_->Find(request.url, cached, true)) {
+                ProcessCached(request, cached);
+            }
+            else {
+                --requests_in_flight_;
+                SetSearchStatus_(request.url, WorkerResult::kErrorNotCached);
+            }
+        }
+        else if (error == QNetworkReply::NoError) {
+            if (request.is_revalidating) {
+                cache_->AddMiss();
+            }
+
+            if (!ReadChunk(request, reply, true)) {
+                if (!request.matcher) {
+                    SelectMatcher(request, detectCharset(reply->rawHeader("Content-Type"), nullptr, 0));
                 }
-                else {
-                    ProcessError(url, error);
+                request.is_found = request.matcher->Finish(request.match_state);
+
+                // Only whole bodies are cached, a found page was cut short
+                if (cache_ && status_code == 200) {
+                    StoreResponse(request, reply);
                 }
             }
+
+            if (request.is_corrupt) {
+                --requests_in_flight_;
+                SetSearchStatus_(request.url, WorkerResult::kErrorUnknown);
+            }
             else {
-               // timeout
-               is_proccessed_ = false;
-               SetSearchStatus_(url, WorkerResult::kErrorTimeout);
-               disconnect(reply, SIGNAL(finished()), &event, SLOT(quit()));
-               reply->abort();
+                ProcessReply(request);
             }
         }
+        else {
+            ProcessError(request.url, error);
+        }
     }
 
-    emit finished();
+    Dispatch();
 }
 
-void SearchWorker::Pause()
+bool SearchWorker::ReadChunk(Request& request, QNetworkReply* reply, bool is_last)
 {
-    state_ = State::kPaused;
+    // Every chunk is read into the same worker-owned buffer and decoded into
+    // a second one, the matcher and then the link extractor scan the decoded
+    // piece in place while it is still in cache
+    auto buffer {read_buffer_.data()};
+    qint64 size {0};
+
+    // Captured by reference alone, the callback fits in the std::function
+    // the decoder takes without an allocation per chunk
+    struct Chunk
+    {
+        Request&        request;
+        QNetworkReply*  reply;
+        qint64          decoded_size;
+    } chunk {request, reply, 0};
+
+    auto Write = [this, &chunk](const char* data, qint64 size) {
+        if (!chunk.request.matcher) {
+            SelectMatcher(chunk.request, detectCharset(chunk.reply->rawHeader("Content-Type"), data, size));
+        }
+
+        if (cache_) {
+            chunk.request.body.append(data, size);
+        }
+        chunk.decoded_size += size;
+        ScanChunk(chunk.request, data, size);
+        return !chunk.request.is_found;
+    };
+
+    if (!request.decoder) {
+        request.decoder.reset(new ContentDecoder(reply->rawHeader("Content-Encoding")));
+    }
+
+    while (!request.is_found && !request.is_corrupt && (size = reply->read(buffer, read_buffer_.size())) > 0) {
+        chunk.decoded_size = 0;
+        if (!request.decoder->Feed(buffer, size, decode_buffer_.data(), decode_buffer_.size(), Write)) {
+            request.is_corrupt = true;
+        }
+
+        if (transfer_) {
+            transfer_->Add(size, chunk.decoded_size);
+        }
+    }
+
+    // A truncated body would pass for a whole page without its end
+    if (is_last && !request.is_found && !request.is_corrupt) {
+        chunk.decoded_size = 0;
+        if (!request.decoder->Finish(decode_buffer_.data(), decode_buffer_.size(), Write)) {
+            request.is_corrupt = true;
+        }
+
+        if (transfer_) {
+            transfer_->Add(0, chunk.decoded_size);
+        }
+    }
+
+    // A corrupt body is not read any further either
+    return request.is_found || request.is_corrupt;
 }
 
-void SearchWorker::Resume()
+void SearchWorker::SelectMatcher(Request& request, const QByteArray& charset)
 {
-    state_ = State::kRunning;
+    request.matcher = matchers_->Get(charset);
+    if (scorer_) {
+        scorer_->Start(request.relevance, charset);
+    }
 }
 
-void SearchWorker::Stop()
+void SearchWorker::ScanChunk(Request& request, const char* data, qint64 size)
 {
-    state_ = State::kStopped;
+    auto match_started_at {clock_.nsecsElapsed()};
+    auto is_found {request.matcher->Feed(request.match_state, data, size)};
+    auto parse_started_at {clock_.nsecsElapsed()};
+    request.match_ns += parse_started_at - match_started_at;
+    Trace("match", match_started_at, parse_started_at);
+
+    if (is_found) {
+        request.is_found = true;
+    }
+    else {
+        request.links.Feed(data, size);
+        if (scorer_) {
+            scorer_->Feed(request.relevance, data, size);
+        }
+        if (content_) {
+            content_->Feed(request.content, data, size);
+        }
+        auto parsed_at {clock_.nsecsElapsed()};
+        request.parse_ns += parsed_at - parse_started_at;
+        Trace("parse", parse_started_at, parsed_at);
+    }
 }
 
-bool SearchWorker::IsProcessed() const
+void SearchWorker::ProcessCached(Request& request, const CachedResponse& cached)
 {
-    return is_proccessed_;
+    cache_->AddHit();
+
+    auto data {cached.body.constData()};
+    qint64 size {cached.body.size()};
+    SelectMatcher(request, detectCharset(cached.content_type, data, size));
+
+    for (qint64 pos = 0; pos < size && !request.is_found; pos += READ_BUFFER_SIZE) {
+        ScanChunk(request, data + pos, std::min<qint64>(READ_BUFFER_SIZE, size - pos));
+    }
+    if (!request.is_found) {
+        request.is_found = request.matcher->Finish(request.match_state);
+    }
+
+    ProcessReply(request);
 }
 
-// Private
+void SearchWorker::StoreResponse(const Request& request, QNetworkReply* reply)
+{
+    CachedResponse response;
+    response.etag = reply->rawHeader("ETag");
+    response.last_modified = reply->rawHeader("Last-Modified");
+    response.content_type = reply->rawHeader("Content-Type");
+    response.body = request.body;
+    cache_->Store(request.url, response);
+}
 
-void SearchWorker::ProcessReply(const QString& url, const QString& data)
+void SearchWorker::ProcessReply(Request& request)
 {
-    if (data.contains(search_text_)) {
-        is_proccessed_ = false;
-        SetSearchStatus_(url, WorkerResult::kFound);
+    Record(MetricStage::kMatch, request.match_ns);
+    Record(MetricStage::kLinkParse, request.parse_ns);
+
+    if (request.is_found) {
+        --requests_in_flight_;
+        SetSearchStatus_(request.url, WorkerResult::kFound);
     }
     else {
-        ParseUrls(data);
-        is_proccessed_ = false;
-        SetSearchStatus_(url, WorkerResult::kNotFound);
+        // A copy of a page crawled before links to the pages it did
+        if (IsNewContent(request)) {
+            ParseUrls(request);
+        }
+        --requests_in_flight_;
+        SetSearchStatus_(request.url, WorkerResult::kNotFound);
     }
 }
 
@@ -120,6 +527,9 @@ void SearchWorker::ProcessError(const QString& url, QNetworkReply::NetworkError
         break;
     case QNetworkReply::NetworkError::HostNotFoundError:
         status = WorkerResult::kErrorHostNotFound;
+        if (resolver_) {
+            resolver_->SetNotFound(QUrl(url).host());
+        }
         break;
     case QNetworkReply::NetworkError::TimeoutError:
         status = WorkerResult::kErrorTimeout;
@@ -148,22 +558,31 @@ void SearchWorker::ProcessError(const QString& url, QNetworkReply::NetworkError
 
     }
 
-    is_proccessed_ = false;
+    --requests_in_flight_;
     SetSearchStatus_(url, status);
 }
 
-void SearchWorker::ParseUrls(const QString& data)
+bool SearchWorker::IsNewContent(Request& request)
+{
+    return !content_ || content_->Check(request.content) == ContentMatch::kUnique;
+}
+
+void SearchWorker::ParseUrls(Request& request)
 {
-    QRegularExpression re(
-                "https?:\\/\\/(www\\.)?"\
-                "[-a-zA-Z0-9@:%._\\+~#=]{1,256}"\
-                "\\.[a-zA-Z0-9()]{1,6}\\b([-a-z"\
-                "A-Z0-9()@:%_\\+.~#?&//=]*)", QRegularExpression::CaseInsensitiveOption);
+    if (!scorer_) {
+        for (const auto& url : request.links.TakeLinks()) {
+            AddSearchedUrl_(url, UrlHint {});
+        }
+        return;
+    }
+
+    QList<QByteArray> anchor_texts;
+    auto links {request.links.TakeLinks(anchor_texts)};
 
-    QRegularExpressionMatchIterator it = re.globalMatch(data);
-    while (it.hasNext()) {
-        QRegularExpressionMatch match = it.next();
-        QString url = match.captured(0);
-        AddSearchedUrl_(url);
+    UrlHint hint;
+    hint.parent = request.url;
+    for (int i = 0; i < links.size(); ++i) {
+        hint.relevance = scorer_->Relevance(request.relevance, links[i], anchor_texts[i]);
+        AddSearchedUrl_(links[i], hint);
     }
 }
@@ -3,6 +3,21 @@
 
 #include <QtNetwork>
 
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "content_decoder.h"
+#include "content_index.h"
+#include "host_resolver.h"
+#include "link_extractor.h"
+#include "metrics.h"
+#include "response_cache.h"
+#include "text_matcher.h"
+#include "trace.h"
+#include "url_scorer.h"
+
 enum class WorkerResult
 {
     kProcess,
@@ -18,6 +33,7 @@ enum class WorkerResult
     kErrorNetworkSessionFailed,
     kErrorUnknownNetwork,
     kErrorProtocolUnknown,
+    kErrorNotCached,
     kErrorUnknown
 };
 
@@ -26,10 +42,18 @@ class SearchWorker : public QObject
     Q_OBJECT
 public:
     explicit SearchWorker(
-        QString search_text = nullptr,
+        std::shared_ptr<TextMatcherCache>                   matchers = nullptr,
+        std::shared_ptr<UrlScorer>                          scorer = nullptr,
+        std::shared_ptr<HostResolver>                       resolver = nullptr,
+        std::shared_ptr<ResponseCache>                      cache = nullptr,
+        std::shared_ptr<ContentIndex>                       content = nullptr,
+        std::shared_ptr<TransferCounters>                   transfer = nullptr,
+        std::shared_ptr<MetricsShard>                       metrics = nullptr,
+        std::shared_ptr<TraceBuffer>                        trace = nullptr,
+        ushort max_requests = 1,
         std::function<void(const QString&, WorkerResult)>   SetSearchStatus = nullptr,
-        std::function<QString()>                            GetSearchedUrl = nullptr,
-        std::function<void(const QString&)>                 AddSearchedUrl = nullptr
+        std::function<QString(bool)>                        GetSearchedUrl = nullptr,
+        std::function<void(const QString&, const UrlHint&)> AddSearchedUrl = nullptr
     );
 
     ~SearchWorker();
@@ -50,8 +74,14 @@ signals:
 
     void finished();
 
+private slots:
+    void Dispatch();
+
 private:
 
+    // Feeds bodies through ReadChunk without a network
+    friend class ReadChunkAllocationTest;
+
     enum class State
     {
         kRunning,
@@ -59,20 +89,95 @@ private:
         kStopped,
     };
 
-    QString search_text_;
+    struct Request
+    {
+        QString                             url;
+        bool                                timed_out = false;
+        bool                                is_found = false;
+        // Sent with the validators of a cached copy
+        bool                                is_revalidating = false;
+        // The body could not be decoded
+        bool                                is_corrupt = false;
+        // Picked from the Content-Encoding once the first bytes arrive
+        std::unique_ptr<ContentDecoder>     decoder {};
+        // Picked from the page charset once the first bytes arrive
+        std::shared_ptr<const TextMatcher>  matcher {};
+        TextMatcher::State                  match_state {};
+        LinkExtractor                       links {};
+        // Search keywords seen on the page, only with a scorer
+        UrlScorer::Page                     relevance {};
+        // Hashes of the body, only with a content index
+        ContentIndex::Page                  content {};
+        // Kept for the response cache
+        QByteArray                          body {};
+
+        // ns of the worker clock, -1 until the step happens
+        qint64                              started_at = -1;
+        qint64                              connecting_at = -1;
+        qint64                              sent_at = -1;
+        qint64                              first_byte_at = -1;
+        // Spent scanning the body
+        qint64                              match_ns = 0;
+        qint64                              parse_ns = 0;
+    };
 
-    bool    is_proccessed_ = false;
-    State   state_ = State::kRunning;
+    std::shared_ptr<TextMatcherCache>   matchers_;
+    std::shared_ptr<UrlScorer>          scorer_;
+    std::shared_ptr<HostResolver>       resolver_;
+    std::shared_ptr<ResponseCache>      cache_;
+    std::shared_ptr<ContentIndex>       content_;
+    std::shared_ptr<TransferCounters>   transfer_;
+    std::shared_ptr<MetricsShard>       metrics_;
+    std::shared_ptr<TraceBuffer>        trace_;
+    // The trace clock when tracing, so spans reuse the metrics timestamps
+    QElapsedTimer                       clock_ {};
+    std::vector<char>                   read_buffer_;
+    std::vector<char>                   decode_buffer_;
+    ushort                              max_requests_;
+
+    std::atomic<int>    requests_in_flight_ {0};
+    std::atomic<State>  state_ {State::kRunning};
+    bool                is_finished_ = false;
+
+    QNetworkAccessManager*                          manager_ = nullptr;
+    std::unordered_map<QNetworkReply*, Request>     requests_ {};
 
     std::function<void(const QString&, WorkerResult)>   SetSearchStatus_;
-    std::function<QString()>                            GetSearchedUrl_;
-    std::function<void(const QString&)>                 AddSearchedUrl_;
+    std::function<QString(bool)>                        GetSearchedUrl_;
+    std::function<void(const QString&, const UrlHint&)> AddSearchedUrl_;
+
+    void Fetch(const QString& url);
+
+    void Finish();
+
+    void Record(MetricStage stage, qint64 ns);
+
+    void RecordTimings(const Request& request);
 
-    void ProcessReply(const QString& url, const QString& data);
+    void Trace(const char* name, qint64 start, qint64 end);
+
+    void OnReplyReadyRead(QNetworkReply* reply);
+
+    void OnReplyFinished(QNetworkReply* reply);
+
+    // is_last once the reply finished, a compressed stream must end with it
+    bool ReadChunk(Request& request, QNetworkReply* reply, bool is_last = false);
+
+    void SelectMatcher(Request& request, const QByteArray& charset);
+
+    void ScanChunk(Request& request, const char* data, qint64 size);
+
+    void ProcessCached(Request& request, const CachedResponse& cached);
+
+    void StoreResponse(const Request& request, QNetworkReply* reply);
+
+    void ProcessReply(Request& request);
 
     void ProcessError(const QString& url, QNetworkReply::NetworkError error);
 
-    void ParseUrls(const QString& data);
+    bool IsNewContent(Request& request);
+
+    void ParseUrls(Request& request);
 };
 
 #endif // SEARCHWORKER_H
@@ -0,0 +1,270 @@
+#include "seen_url_set.h"
+
+#include <QDataStream>
+
+#include <algorithm>
+#include <cmath>
+
+#include "fingerprint.h"
+
+static constexpr size_t TABLE_INITIAL_SIZE = 64;
+static constexpr size_t TABLE_MAX_LOAD_PERCENT = 70;
+static constexpr uint   BLOOM_MAX_HASHES = 16;
+
+static size_t roundUpToPowerOfTwo(size_t value)
+{
+    size_t result {1};
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+// The low bits pick the shard, slots are addressed with the high half
+static inline size_t slotIndex(quint64 fingerprint, size_t mask)
+{
+    return static_cast<size_t>((fingerprint >> 32) | (fingerprint << 32)) & mask;
+}
+
+SeenUrlSet::SeenUrlSet(size_t shards_count) :
+    shards_ {new Shard[roundUpToPowerOfTwo(shards_count)]},
+    shards_mask_ {roundUpToPowerOfTwo(shards_count) - 1}
+{
+
+}
+
+void SeenUrlSet::Reset(uint max_urls, SeenSetMode mode, double false_positive_rate)
+{
+    max_urls_ = max_urls;
+    mode_ = mode;
+
+    if (mode_ == SeenSetMode::kBloomFilter) {
+        // m = -n ln(p) / ln(2)^2 bits in total, k = m / n ln(2) hashes
+        auto rate {std::min(std::max(false_positive_rate, 1e-9), 0.5)};
+        auto urls {std::max<double>(max_urls, 1)};
+        auto bits {std::ceil(-urls * std::log(rate) / (std::log(2.0) * std::log(2.0)))};
+        auto shards_count {shards_mask_ + 1};
+
+        bloom_bits_ = std::max<size_t>((static_cast<size_t>(bits) / shards_count + 63) / 64 * 64, 64);
+        bloom_hashes_ = std::min(std::max<uint>(std::lround(bits / urls * std::log(2.0)), 1), BLOOM_MAX_HASHES);
+    }
+
+    for (size_t i = 0; i <= shards_mask_; ++i) {
+        QMutexLocker locker(&shards_[i].mutex);
+        auto& slots {shards_[i].slots};
+        if (mode_ == SeenSetMode::kBloomFilter) {
+            slots.assign(bloom_bits_ / 64, 0);
+        }
+        else {
+            std::vector<quint64>().swap(slots);
+        }
+        shards_[i].used = 0;
+    }
+    size_ = 0;
+}
+
+bool SeenUrlSet::Insert(const QString& url)
+{
+    auto fingerprint {UrlFingerprint(url)};
+    auto& shard {shards_[fingerprint & shards_mask_]};
+    QMutexLocker locker(&shard.mutex);
+
+    return mode_ == SeenSetMode::kBloomFilter
+            ? InsertBloom(shard, fingerprint)
+            : InsertFingerprint(shard, fingerprint);
+}
+
+void SeenUrlSet::Clear()
+{
+    for (size_t i = 0; i <= shards_mask_; ++i) {
+        QMutexLocker locker(&shards_[i].mutex);
+        auto& slots {shards_[i].slots};
+        if (mode_ == SeenSetMode::kBloomFilter) {
+            std::fill(slots.begin(), slots.end(), 0);
+        }
+        else {
+            std::vector<quint64>().swap(slots);
+        }
+        shards_[i].used = 0;
+    }
+    size_ = 0;
+}
+
+QByteArray SeenUrlSet::Save() const
+{
+    QByteArray data;
+    QDataStream stream {&data, QIODevice::WriteOnly};
+    stream.setVersion(QDataStream::Qt_5_12);
+
+    stream << static_cast<quint8>(mode_) << static_cast<quint64>(shards_mask_ + 1)
+           << static_cast<quint64>(bloom_bits_) << static_cast<quint32>(bloom_hashes_);
+
+    for (size_t i = 0; i <= shards_mask_; ++i) {
+        QMutexLocker locker(&shards_[i].mutex);
+        const auto& slots {shards_[i].slots};
+        stream << static_cast<quint64>(shards_[i].used) << static_cast<quint64>(slots.size());
+        stream.writeRawData(reinterpret_cast<const char*>(slots.data()), slots.size() * sizeof(quint64));
+    }
+
+    return data;
+}
+
+bool SeenUrlSet::Load(const QByteArray& data)
+{
+    QDataStream stream {data};
+    stream.setVersion(QDataStream::Qt_5_12);
+
+    quint8 mode {0};
+    quint64 shards_count {0};
+    quint64 bloom_bits {0};
+    quint32 bloom_hashes {0};
+    stream >> mode >> shards_count >> bloom_bits >> bloom_hashes;
+    if (stream.status() != QDataStream::Ok || shards_count != shards_mask_ + 1) {
+        return false;
+    }
+
+    // The bloom bits only make sense with the parameters they were set with
+    mode_ = static_cast<SeenSetMode>(mode);
+    bloom_bits_ = bloom_bits;
+    bloom_hashes_ = bloom_hashes;
+
+    size_t size {0};
+    for (size_t i = 0; i <= shards_mask_; ++i) {
+        quint64 used {0};
+        quint64 slots_count {0};
+        stream >> used >> slots_count;
+        if (stream.status() != QDataStream::Ok || slots_count > static_cast<quint64>(data.size())) {
+            Clear();
+            return false;
+        }
+
+        QMutexLocker locker(&shards_[i].mutex);
+        auto& slots {shards_[i].slots};
+        slots.assign(slots_count, 0);
+        auto bytes {static_cast<int>(slots_count * sizeof(quint64))};
+        if (stream.readRawData(reinterpret_cast<char*>(slots.data()), bytes) != bytes) {
+            locker.unlock();
+            Clear();
+            return false;
+        }
+        shards_[i].used = used;
+        size += used;
+    }
+    size_ = static_cast<uint>(size);
+
+    return true;
+}
+
+size_t SeenUrlSet::Size() const
+{
+    return size_;
+}
+
+bool SeenUrlSet::IsFull() const
+{
+    return size_ >= max_urls_;
+}
+
+size_t SeenUrlSet::MemoryUsage() const
+{
+    size_t bytes {sizeof(*this) + (shards_mask_ + 1) * sizeof(Shard)};
+    for (size_t i = 0; i <= shards_mask_; ++i) {
+        QMutexLocker locker(&shards_[i].mutex);
+        bytes += shards_[i].slots.capacity() * sizeof(quint64);
+    }
+    return bytes;
+}
+
+double SeenUrlSet::BytesPerUrl() const
+{
+    return static_cast<double>(MemoryUsage()) / std::max<size_t>(Size(), 1);
+}
+
+// Private
+
+bool SeenUrlSet::ReserveSlot()
+{
+    // Reserve a slot first so concurrent inserts never overshoot max_urls_
+    auto size {size_.load()};
+    do {
+        if (size >= max_urls_) {
+            return false;
+        }
+    } while (!size_.compare_exchange_weak(size, size + 1));
+
+    return true;
+}
+
+bool SeenUrlSet::InsertFingerprint(Shard& shard, quint64 fingerprint)
+{
+    // Zero marks an empty slot
+    if (fingerprint == 0) {
+        fingerprint = 1;
+    }
+
+    if (shard.slots.empty()) {
+        shard.slots.assign(TABLE_INITIAL_SIZE, 0);
+    }
+
+    auto mask {shard.slots.size() - 1};
+    auto index {slotIndex(fingerprint, mask)};
+    while (shard.slots[index] != 0) {
+        if (shard.slots[index] == fingerprint) {
+            return false;
+        }
+        index = (index + 1) & mask;
+    }
+
+    if (!ReserveSlot()) {
+        return false;
+    }
+
+    shard.slots[index] = fingerprint;
+    if (++shard.used * 100 > shard.slots.size() * TABLE_MAX_LOAD_PERCENT) {
+        GrowTable(shard);
+    }
+    return true;
+}
+
+bool SeenUrlSet::InsertBloom(Shard& shard, quint64 fingerprint)
+{
+    // Kirsch-Mitzenmacher double hashing over the bits of this shard
+    auto hash1 {fingerprint >> 32};
+    auto hash2 {(fingerprint << 32 | fingerprint >> 32) | 1};
+
+    bool is_present {true};
+    for (uint i = 0; i < bloom_hashes_ && is_present; ++i) {
+        auto bit {(hash1 + i * hash2) % bloom_bits_};
+        is_present = shard.slots[bit / 64] & (1ULL << (bit % 64));
+    }
+
+    if (is_present || !ReserveSlot()) {
+        return false;
+    }
+
+    for (uint i = 0; i < bloom_hashes_; ++i) {
+        auto bit {(hash1 + i * hash2) % bloom_bits_};
+        shard.slots[bit / 64] |= 1ULL << (bit % 64);
+    }
+    ++shard.used;
+    return true;
+}
+
+void SeenUrlSet::GrowTable(Shard& shard)
+{
+    std::vector<quint64> slots(shard.slots.size() * 2, 0);
+    auto mask {slots.size() - 1};
+
+    for (auto fingerprint : shard.slots) {
+        if (fingerprint == 0) {
+            continue;
+        }
+        auto index {slotIndex(fingerprint, mask)};
+        while (slots[index] != 0) {
+            index = (index + 1) & mask;
+        }
+        slots[index] = fingerprint;
+    }
+
+    shard.slots.swap(slots);
+}
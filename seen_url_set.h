@@ -0,0 +1,85 @@
+#ifndef SEENURLSET_H
+#define SEENURLSET_H
+
+#include <QByteArray>
+#include <QString>
+#include <QMutex>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+enum class SeenSetMode
+{
+    // Exact up to 64-bit fingerprint collisions, ~12-24 bytes per url
+    kFingerprint,
+    // Fixed size for the whole crawl, a false positive skips an unseen url
+    kBloomFilter
+};
+
+// Set of urls already admitted to the crawl. Urls are reduced to 64-bit
+// fingerprints and split into independently locked shards, so concurrent
+// inserts rarely share a lock and no url string is kept.
+class SeenUrlSet
+{
+public:
+    explicit SeenUrlSet(size_t shards_count = 64);
+
+    void Reset(
+        uint max_urls,
+        SeenSetMode mode = SeenSetMode::kFingerprint,
+        double false_positive_rate = 0.001
+    );
+
+    // Adds the url unless it is already known or the set is full
+    bool Insert(const QString& url);
+
+    void Clear();
+
+    // Serialized shards, Load keeps the max_urls of the last Reset
+    QByteArray Save() const;
+
+    bool Load(const QByteArray& data);
+
+    size_t Size() const;
+
+    // Inserts fail from now on, seen or not
+    bool IsFull() const;
+
+    size_t MemoryUsage() const;
+
+    double BytesPerUrl() const;
+
+private:
+
+    // Open-addressing fingerprint table, or the bit array in bloom mode
+    struct Shard
+    {
+        mutable QMutex          mutex;
+        std::vector<quint64>    slots;
+        size_t                  used = 0;
+
+        // Keeps neighbouring shard locks off the same cache line
+        char padding[64];
+    };
+
+    std::unique_ptr<Shard[]>    shards_;
+    size_t                      shards_mask_;
+
+    std::atomic<uint>   size_ {0};
+    uint                max_urls_ = 0;
+
+    SeenSetMode mode_ = SeenSetMode::kFingerprint;
+    size_t      bloom_bits_ = 0;
+    uint        bloom_hashes_ = 0;
+
+    bool ReserveSlot();
+
+    bool InsertFingerprint(Shard& shard, quint64 fingerprint);
+
+    bool InsertBloom(Shard& shard, quint64 fingerprint);
+
+    void GrowTable(Shard& shard);
+};
+
+#endif // SEENURLSET_H
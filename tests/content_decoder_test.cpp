@@ -0,0 +1,74 @@
+#include <QtTest>
+
+#include <algorithm>
+#include <vector>
+
+#include "content_decoder.h"
+
+static constexpr auto BUFFER_SIZE = 4 * 1024;
+
+static QByteArray buildPage()
+{
+    QByteArray page;
+    for (int i = 0; i < 1000; ++i) {
+        page.append("<p>Line " + QByteArray::number(i) + " of the page.</p>\n");
+    }
+    return page;
+}
+
+class ContentDecoderTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void finish_data();
+
+    void finish();
+};
+
+void ContentDecoderTest::finish_data()
+{
+    QTest::addColumn<QByteArray>("content_encoding");
+    QTest::addColumn<QByteArray>("body");
+    QTest::addColumn<bool>("is_complete");
+
+    auto page {buildPage()};
+    // A zlib stream, without the length qCompress puts in front
+    auto compressed {qCompress(page).mid(4)};
+
+    QTest::newRow("identity") << QByteArray() << page << true;
+    QTest::newRow("deflate") << QByteArray("deflate") << compressed << true;
+    QTest::newRow("deflate truncated") << QByteArray("deflate") << compressed.left(compressed.size() / 2) << false;
+    QTest::newRow("deflate one byte") << QByteArray("deflate") << compressed.left(1) << false;
+    QTest::newRow("deflate empty") << QByteArray("deflate") << QByteArray() << true;
+}
+
+void ContentDecoderTest::finish()
+{
+    QFETCH(QByteArray, content_encoding);
+    QFETCH(QByteArray, body);
+    QFETCH(bool, is_complete);
+
+    ContentDecoder decoder {content_encoding};
+    std::vector<char> buffer(BUFFER_SIZE);
+    QByteArray decoded;
+    auto Write = [&decoded](const char* data, qint64 size) {
+        decoded.append(data, static_cast<int>(size));
+        return true;
+    };
+
+    // Fed a few bytes at a time, as the chunks of a reply
+    for (int pos = 0; pos < body.size(); pos += 100) {
+        auto size {std::min<qint64>(100, body.size() - pos)};
+        QVERIFY(decoder.Feed(body.constData() + pos, size, buffer.data(), buffer.size(), Write));
+    }
+
+    QCOMPARE(decoder.Finish(buffer.data(), buffer.size(), Write), is_complete);
+    if (is_complete && !body.isEmpty()) {
+        QCOMPARE(decoded, buildPage());
+    }
+}
+
+QTEST_GUILESS_MAIN(ContentDecoderTest)
+
+#include "content_decoder_test.moc"
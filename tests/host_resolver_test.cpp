@@ -0,0 +1,164 @@
+#include <QtTest>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#include "search_engine.h"
+
+// Hosts under .invalid never resolve, no resolver answers for them
+static const QStringList gMissingUrls {
+    "http://missing.invalid/1",
+    "http://missing.invalid/2",
+    "http://missing.invalid/3",
+    "http://missing.invalid/4"
+};
+
+// Crawl time allowed, a lookup may wait on an unreachable name server
+static constexpr auto CRAWL_TIMEOUT = 30000; // ms
+static constexpr auto SETTLE_TIME = 200; // ms
+
+// Local stand-in for a site, answers every request with the same page
+class PageServer : public QObject
+{
+public:
+    explicit PageServer(const QByteArray& page) :
+        page_ {page}
+    {
+        connect(&server_, &QTcpServer::newConnection, this, [this]() {
+            OnNewConnection();
+        });
+    }
+
+    bool Listen()
+    {
+        return server_.listen(QHostAddress::LocalHost);
+    }
+
+    QString Url() const
+    {
+        return QString("http://127.0.0.1:%1/").arg(server_.serverPort());
+    }
+
+private:
+
+    QTcpServer                      server_ {};
+    QHash<QTcpSocket*, QByteArray>  pending_input_ {};
+    QByteArray                      page_;
+
+    void OnNewConnection()
+    {
+        while (server_.hasPendingConnections()) {
+            auto socket {server_.nextPendingConnection()};
+
+            connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+                OnReadyRead(socket);
+            });
+            connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+                pending_input_.remove(socket);
+                socket->deleteLater();
+            });
+        }
+    }
+
+    void OnReadyRead(QTcpSocket* socket)
+    {
+        auto& input {pending_input_[socket]};
+        input.append(socket->readAll());
+        if (!input.contains("\r\n\r\n")) {
+            return;
+        }
+        input.clear();
+
+        socket->write("HTTP/1.1 200 OK\r\n"
+                      "Content-Type: text/html; charset=utf-8\r\n"
+                      "Content-Length: " + QByteArray::number(page_.size()) + "\r\n"
+                      "Connection: close\r\n"
+                      "\r\n" + page_);
+        socket->disconnectFromHost();
+    }
+};
+
+class HostResolverTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void notFoundHostExpires();
+
+    void crawlSkipsHostNotFound();
+};
+
+void HostResolverTest::initTestCase()
+{
+    qRegisterMetaType<UrlSearchStatus>("UrlSearchStatus");
+    qRegisterMetaType<SearchResult>("SearchResult");
+}
+
+void HostResolverTest::notFoundHostExpires()
+{
+    ResolverOptions options;
+    options.negative_ttl = 200;
+    HostResolver resolver {options};
+
+    resolver.SetNotFound("missing.invalid");
+    resolver.SetNotFound("127.0.0.1");
+
+    QVERIFY(resolver.IsNotFound("missing.invalid"));
+    QVERIFY(!resolver.IsNotFound("other.invalid"));
+    // Addresses are not looked up, so never counted
+    QVERIFY(!resolver.IsNotFound("127.0.0.1"));
+
+    auto stats {resolver.Stats()};
+    QCOMPARE(stats.lookups, quint64(2));
+    QCOMPARE(stats.negative_hits, quint64(1));
+
+    QTRY_VERIFY(!resolver.IsNotFound("missing.invalid"));
+}
+
+void HostResolverTest::crawlSkipsHostNotFound()
+{
+    QByteArray page {"<html><body>"};
+    for (const auto& url : gMissingUrls) {
+        page.append("<a href=\"" + url.toUtf8() + "\">missing</a>");
+    }
+    page.append("</body></html>");
+
+    PageServer server {page};
+    QVERIFY(server.Listen());
+
+    SearchEngine engine;
+    QHash<QString, UrlSearchStatus> statuses;
+    bool is_finished {false};
+    QObject::connect(&engine, &SearchEngine::update_url_status, [&statuses](const QString& url, UrlSearchStatus status) {
+        if (status != UrlSearchStatus::kProcess) {
+            statuses.insert(url, status);
+        }
+    });
+    QObject::connect(&engine, &SearchEngine::search_result, [&is_finished](SearchResult) {
+        is_finished = true;
+    });
+
+    // One request at a time, the first missing url is fetched before the others
+    engine.Start(server.Url(), 1, 1, QStringList {"text found on no page"}, 100);
+    QTRY_VERIFY_WITH_TIMEOUT(is_finished, CRAWL_TIMEOUT);
+    auto stats {engine.GetResolverStats()};
+    engine.Stop();
+    QTest::qWait(SETTLE_TIME);
+
+    QCOMPARE(statuses.size(), gMissingUrls.size() + 1);
+    if (statuses.value(gMissingUrls.front()) == UrlSearchStatus::kErrorTimeout) {
+        QSKIP("The name lookup timed out, no name server answers here");
+    }
+
+    // Only the first of them went to the network
+    for (const auto& url : gMissingUrls) {
+        QCOMPARE(statuses.value(url), UrlSearchStatus::kErrorHostNotFound);
+    }
+    QCOMPARE(stats.lookups, quint64(gMissingUrls.size()));
+    QCOMPARE(stats.negative_hits, quint64(gMissingUrls.size() - 1));
+}
+
+QTEST_GUILESS_MAIN(HostResolverTest)
+
+#include "host_resolver_test.moc"
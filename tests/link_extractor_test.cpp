@@ -0,0 +1,85 @@
+#include <QtTest>
+
+#include <cstring>
+
+#include "link_extractor.h"
+
+static const QUrl gPageUrl {"http://example.com/dir/page.html"};
+
+static QStringList extractLinks(const char* html)
+{
+    LinkExtractor extractor {gPageUrl};
+    extractor.Feed(html, std::strlen(html));
+    return extractor.TakeLinks();
+}
+
+class LinkExtractorTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void linkTags();
+
+    void baseTag();
+
+    void characterReferences();
+
+    void rawTextEndTag();
+};
+
+void LinkExtractorTest::linkTags()
+{
+    auto links {extractLinks(
+        "<link href=\"/style.css\" rel=\"stylesheet\">"
+        "<img src=\"/image.png\"><script src=\"/script.js\"></script>"
+        "<a href=\"/a\">a</a><map><area href=\"/area\"></map>"
+        "<iframe src=\"/iframe\"></iframe><frame src=\"/frame\">"
+        "<div href=\"/div\" src=\"/div\"></div>"
+    )};
+
+    QCOMPARE(links, QStringList({
+        "http://example.com/a",
+        "http://example.com/area",
+        "http://example.com/iframe",
+        "http://example.com/frame"
+    }));
+}
+
+void LinkExtractorTest::baseTag()
+{
+    auto links {extractLinks("<base href=\"http://other.com/base/\"><a href=\"page\">page</a>")};
+
+    QCOMPARE(links, QStringList({"http://other.com/base/page"}));
+}
+
+void LinkExtractorTest::characterReferences()
+{
+    auto links {extractLinks(
+        "<a href=\"/q?a=1&amp;b=2\"></a>"
+        "<a href=\"/q?a=1&#38;b=2\"></a>"
+        "<a href=\"/q?a=1&#x26;b=2\"></a>"
+        "<a href=\"/q?a=1&copy=2\"></a>"
+    )};
+
+    QCOMPARE(links, QStringList({
+        "http://example.com/q?a=1&b=2",
+        "http://example.com/q?a=1&b=2",
+        "http://example.com/q?a=1&b=2",
+        "http://example.com/q?a=1&copy=2"
+    }));
+}
+
+void LinkExtractorTest::rawTextEndTag()
+{
+    auto links {extractLinks(
+        "<script>var a = \"</scripts><a href='/script'>\";</script >"
+        "<style>p { content: \"</styleSheet><a href='/style'>\" }</style>"
+        "<a href=\"/after\">after</a>"
+    )};
+
+    QCOMPARE(links, QStringList({"http://example.com/after"}));
+}
+
+QTEST_GUILESS_MAIN(LinkExtractorTest)
+
+#include "link_extractor_test.moc"
@@ -0,0 +1,106 @@
+#include <QtTest>
+#include <QThread>
+
+#include <sys/resource.h>
+
+#include "search_engine.h"
+#include "synthetic_server.h"
+
+// Long enough for every worker to have requests in flight
+static constexpr auto CRAWL_TIME = 300; // ms
+// Replies in flight when the crawl is paused still come in
+static constexpr auto SETTLE_TIME = 500; // ms
+static constexpr auto PAUSE_TIME = 1000; // ms
+// A single worker spinning while paused would burn about all of PAUSE_TIME
+static constexpr auto PAUSED_CPU_TIME_MAX = 100; // ms
+
+static qint64 processCpuTimeMs()
+{
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000LL
+        + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+}
+
+class PausedCrawlTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void cleanupTestCase();
+
+    void pausedCrawlUsesNoCpu();
+
+private:
+
+    SyntheticServer*    server_ = nullptr;
+    QThread             server_thread_ {};
+};
+
+void PausedCrawlTest::initTestCase()
+{
+    qRegisterMetaType<UrlSearchStatus>("UrlSearchStatus");
+    qRegisterMetaType<SearchResult>("SearchResult");
+
+    // Far more pages than the crawl gets through, none holding the text
+    SyntheticSiteConfig config;
+    config.pages_count = 100000;
+    config.page_size = 4 * 1024;
+    config.latency = LatencyDistribution::kFixed;
+    config.latency_mean_ms = 5;
+
+    server_ = new SyntheticServer(config);
+    server_->moveToThread(&server_thread_);
+    server_thread_.start();
+
+    bool is_listening {false};
+    QMetaObject::invokeMethod(server_, "Listen", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(bool, is_listening));
+    QVERIFY(is_listening);
+}
+
+void PausedCrawlTest::cleanupTestCase()
+{
+    server_thread_.quit();
+    server_thread_.wait();
+    delete server_;
+}
+
+void PausedCrawlTest::pausedCrawlUsesNoCpu()
+{
+    SearchEngine engine;
+    int updates_count {0};
+    QObject::connect(&engine, &SearchEngine::update_url_status, [&updates_count](const QString&, UrlSearchStatus) {
+        ++updates_count;
+    });
+
+    engine.Start(server_->PageUrl(0), 4, 4, QStringList {"text found on no page"}, 100000);
+    QTest::qWait(CRAWL_TIME);
+    QVERIFY(updates_count > 0);
+
+    engine.Pause();
+    QTest::qWait(SETTLE_TIME);
+
+    auto updates_paused {updates_count};
+    auto cpu_time_paused {processCpuTimeMs()};
+    QTest::qWait(PAUSE_TIME);
+    auto cpu_time {processCpuTimeMs() - cpu_time_paused};
+
+    QVERIFY2(cpu_time < PAUSED_CPU_TIME_MAX,
+             qPrintable(QString("%1 ms of CPU time while paused").arg(cpu_time)));
+    QCOMPARE(updates_count, updates_paused);
+
+    // The parked workers wake up again
+    engine.Resume();
+    QTRY_VERIFY(updates_count > updates_paused);
+
+    engine.Stop();
+    QTest::qWait(SETTLE_TIME);
+}
+
+QTEST_GUILESS_MAIN(PausedCrawlTest)
+
+#include "paused_crawl_test.moc"
@@ -0,0 +1,200 @@
+#include <QtTest>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "search_worker.h"
+
+// Qt containers allocate with malloc rather than operator new, so with
+// glibc malloc itself is counted too
+#ifdef __GLIBC__
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+}
+#endif
+
+static std::atomic<bool> gIsCounting {false};
+static std::atomic<int> gAllocations {0};
+
+static void countAllocation()
+{
+    if (gIsCounting) {
+        ++gAllocations;
+    }
+}
+
+static void* allocate(size_t size)
+{
+    countAllocation();
+#ifdef __GLIBC__
+    return __libc_malloc(size);
+#else
+    return std::malloc(size);
+#endif
+}
+
+void* operator new(size_t size)
+{
+    auto pointer {allocate(size > 0 ? size : 1)};
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+#ifdef __GLIBC__
+extern "C" {
+
+void* malloc(size_t size) noexcept
+{
+    return allocate(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept
+{
+    countAllocation();
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, size_t size) noexcept
+{
+    countAllocation();
+    return __libc_realloc(pointer, size);
+}
+
+}
+#endif
+
+// 64 chunks of the read buffer of a worker
+static constexpr auto PAGE_SIZE = 64 * 64 * 1024;
+
+// Serves a body appended piece by piece, as a reply would while it downloads
+class ChunkedReply : public QNetworkReply
+{
+public:
+    explicit ChunkedReply(const QByteArray& content_encoding)
+    {
+        setOpenMode(QIODevice::ReadOnly | QIODevice::Unbuffered);
+        setRawHeader("Content-Type", "text/html; charset=utf-8");
+        if (!content_encoding.isEmpty()) {
+            setRawHeader("Content-Encoding", content_encoding);
+        }
+    }
+
+    void Append(const QByteArray& data)
+    {
+        body_.append(data);
+    }
+
+    void abort() override
+    {
+
+    }
+
+    qint64 bytesAvailable() const override
+    {
+        return body_.size() - position_ + QNetworkReply::bytesAvailable();
+    }
+
+protected:
+    qint64 readData(char* data, qint64 max_size) override
+    {
+        auto size {std::min<qint64>(max_size, body_.size() - position_)};
+        std::memcpy(data, body_.constData() + position_, static_cast<size_t>(size));
+        position_ += size;
+        return size;
+    }
+
+private:
+
+    QByteArray  body_ {};
+    qint64      position_ = 0;
+};
+
+// Markup without links, with text, attributes, comments and a script
+static QByteArray buildPage(int size)
+{
+    QByteArray page {"<html><head><title>Allocations</title>"
+                     "<script>var row = \"<b>\";</script></head><body>\n"};
+
+    quint32 seed {1};
+    while (page.size() < size) {
+        seed = seed * 1103515245u + 12345u;
+        page.append("<div class=\"row\"><p title=\"item\">Item ");
+        page.append(QByteArray::number(seed));
+        page.append(" of the list, <b>bold</b> and <span>plain</span> text.</p><!-- row --></div>\n");
+    }
+    page.append("</body></html>\n");
+
+    return page;
+}
+
+class ReadChunkAllocationTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void noAllocationPerChunk_data();
+
+    void noAllocationPerChunk();
+};
+
+void ReadChunkAllocationTest::noAllocationPerChunk_data()
+{
+    QTest::addColumn<QByteArray>("content_encoding");
+
+    QTest::newRow("identity") << QByteArray();
+    QTest::newRow("deflate") << QByteArray("deflate");
+}
+
+void ReadChunkAllocationTest::noAllocationPerChunk()
+{
+    QFETCH(QByteArray, content_encoding);
+
+    auto page {buildPage(PAGE_SIZE)};
+    // A zlib stream, without the length qCompress puts in front
+    auto body {content_encoding.isEmpty() ? page : qCompress(page).mid(4)};
+
+    SearchWorker worker {std::make_shared<TextMatcherCache>(QStringList {"text found on no page"}, MatchOptions {})};
+    ChunkedReply reply {content_encoding};
+
+    SearchWorker::Request request;
+    request.url = "http://example.com/";
+    request.links = LinkExtractor(QUrl(request.url));
+
+    // The decoder, the matcher and the buffers of the page are set up by
+    // the first chunks, once per page
+    auto warm_up_size {body.size() / 4};
+    reply.Append(body.left(warm_up_size));
+    QVERIFY(!worker.ReadChunk(request, &reply));
+    QVERIFY(request.matcher);
+
+    reply.Append(body.mid(warm_up_size));
+
+    gAllocations = 0;
+    gIsCounting = true;
+    auto is_done {worker.ReadChunk(request, &reply)};
+    gIsCounting = false;
+
+    QVERIFY(!is_done);
+    QCOMPARE(gAllocations.load(), 0);
+    QVERIFY(request.links.TakeLinks().isEmpty());
+}
+
+QTEST_GUILESS_MAIN(ReadChunkAllocationTest)
+
+#include "read_chunk_allocation_test.moc"
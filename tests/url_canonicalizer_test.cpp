@@ -0,0 +1,92 @@
+#include <QtTest>
+
+#include "url_canonicalizer.h"
+#include "url_frontier.h"
+
+Q_DECLARE_METATYPE(QueryRule)
+
+static constexpr auto MAX_URLS = 1000u;
+
+class UrlCanonicalizerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void canonicalize_data();
+
+    void canonicalize();
+
+    void duplicatesCountedOncePerSpelling();
+};
+
+void UrlCanonicalizerTest::canonicalize_data()
+{
+    QTest::addColumn<QueryRule>("query");
+    QTest::addColumn<QString>("url");
+    QTest::addColumn<QString>("canonical");
+
+    QTest::newRow("http default port") << QueryRule::kKeep
+        << "HTTP://Example.COM:80/a" << "http://example.com/a";
+    QTest::newRow("https default port") << QueryRule::kKeep
+        << "https://example.com:443/a" << "https://example.com/a";
+    QTest::newRow("other scheme's port") << QueryRule::kKeep
+        << "http://example.com:443/a" << "http://example.com:443/a";
+
+    // %7E is an unreserved ~, %2F a slash that must stay escaped
+    QTest::newRow("unreserved escape") << QueryRule::kKeep
+        << "http://example.com/%7euser/a%2fb" << "http://example.com/~user/a%2Fb";
+
+    QTest::newRow("empty path") << QueryRule::kKeep
+        << "http://example.com" << "http://example.com/";
+    QTest::newRow("empty path with query") << QueryRule::kKeep
+        << "http://example.com?q=1" << "http://example.com/?q=1";
+
+    QTest::newRow("ipv6 default port") << QueryRule::kKeep
+        << "http://[::1]:80/a" << "http://[::1]/a";
+    QTest::newRow("ipv6 port") << QueryRule::kKeep
+        << "http://[2001:DB8::1]:8080/" << "http://[2001:db8::1]:8080/";
+
+    // Repeated names keep their order, only the names are sorted
+    QTest::newRow("sorted query") << QueryRule::kSort
+        << "http://example.com/?b=2&a=1&b=1&a=3" << "http://example.com/?a=1&a=3&b=2&b=1";
+    QTest::newRow("kept query") << QueryRule::kKeep
+        << "http://example.com/?b=2&a=1" << "http://example.com/?b=2&a=1";
+}
+
+void UrlCanonicalizerTest::canonicalize()
+{
+    QFETCH(QueryRule, query);
+    QFETCH(QString, url);
+    QFETCH(QString, canonical);
+
+    CanonicalOptions options;
+    options.query = query;
+    UrlCanonicalizer canonicalizer {options};
+
+    QCOMPARE(canonicalizer.Canonicalize(url), canonical);
+    QCOMPARE(canonicalizer.Canonicalize(canonical), canonical);
+}
+
+void UrlCanonicalizerTest::duplicatesCountedOncePerSpelling()
+{
+    UrlFrontier frontier;
+    QVERIFY(frontier.Open(MAX_URLS, 1, FrontierOptions {}));
+
+    QVERIFY(frontier.Push("http://example.com/a"));
+    QVERIFY(!frontier.Push("http://EXAMPLE.com/a"));
+    QVERIFY(!frontier.Push("http://EXAMPLE.com/a"));
+    QVERIFY(!frontier.Push("http://example.com:80/a"));
+    QCOMPARE(frontier.GetCanonicalStats().duplicates, quint64(2));
+
+    // The spelling that admitted its canonical form is no duplicate of it
+    QVERIFY(frontier.Push("http://example.com:80/b"));
+    QVERIFY(!frontier.Push("http://example.com:80/b"));
+    QCOMPARE(frontier.GetCanonicalStats().duplicates, quint64(2));
+    QCOMPARE(frontier.GetCanonicalStats().rewritten, quint64(5));
+
+    frontier.Stop();
+}
+
+QTEST_GUILESS_MAIN(UrlCanonicalizerTest)
+
+#include "url_canonicalizer_test.moc"
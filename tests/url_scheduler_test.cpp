@@ -0,0 +1,43 @@
+#include <QtTest>
+
+#include "url_scheduler.h"
+
+class UrlSchedulerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void bestFirstHostPenalty();
+};
+
+void UrlSchedulerTest::bestFirstHostPenalty()
+{
+    BestFirstScheduler scheduler {PriorityOptions {}};
+    QString url;
+
+    // A queued url of the same host costs the next one its place
+    scheduler.Push("http://a.com/1", 0, UrlHint {});
+    scheduler.Push("http://a.com/2", 0, UrlHint {});
+    scheduler.Push("http://b.com/1", 0, UrlHint {});
+
+    QVERIFY(scheduler.TryPop(url, 0));
+    QCOMPARE(url, QString("http://a.com/1"));
+    QVERIFY(scheduler.TryPop(url, 0));
+    QCOMPARE(url, QString("http://b.com/1"));
+    QVERIFY(scheduler.TryPop(url, 0));
+    QCOMPARE(url, QString("http://a.com/2"));
+    QVERIFY(!scheduler.TryPop(url, 0));
+
+    // Popped urls no longer count, both hosts start over even
+    scheduler.Push("http://a.com/3", 0, UrlHint {});
+    scheduler.Push("http://b.com/2", 0, UrlHint {});
+
+    QVERIFY(scheduler.TryPop(url, 0));
+    QCOMPARE(url, QString("http://a.com/3"));
+    QVERIFY(scheduler.TryPop(url, 0));
+    QCOMPARE(url, QString("http://b.com/2"));
+}
+
+QTEST_GUILESS_MAIN(UrlSchedulerTest)
+
+#include "url_scheduler_test.moc"
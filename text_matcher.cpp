@@ -0,0 +1,442 @@
+#include "text_matcher.h"
+
+#include <QtGlobal>
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <QStringEncoder>
+#else
+#include <QTextCodec>
+#endif
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <queue>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TEXT_MATCHER_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static constexpr uint NO_TRANSITION = UINT_MAX;
+
+static inline uint countTrailingZeros(uint value)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return index;
+#else
+    return __builtin_ctz(value);
+#endif
+}
+
+static inline unsigned char foldCase(unsigned char byte)
+{
+    return (byte >= 'A' && byte <= 'Z') ? byte + ('a' - 'A') : byte;
+}
+
+// Bytes of multi-byte UTF-8 sequences count as word bytes
+static inline bool isWordByte(unsigned char byte)
+{
+    return (byte >= 'a' && byte <= 'z') || (byte >= 'A' && byte <= 'Z')
+            || (byte >= '0' && byte <= '9') || byte == '_' || byte >= 0x80;
+}
+
+static void keepTail(QByteArray& tail, const char* data, size_t size, size_t keep)
+{
+    // Copied over the previous tail, its memory is reused from chunk to chunk
+    if (size >= keep) {
+        tail.resize(static_cast<int>(keep));
+        if (keep > 0) {
+            std::memcpy(tail.data(), data + size - keep, keep);
+        }
+        return;
+    }
+
+    tail.append(data, static_cast<int>(size));
+    if (static_cast<size_t>(tail.size()) > keep) {
+        tail.remove(0, tail.size() - static_cast<int>(keep));
+    }
+}
+
+static QByteArray encode(const QString& text, const QByteArray& charset)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    QStringEncoder encoder(charset.constData());
+    if (encoder.isValid()) {
+        return encoder.encode(text);
+    }
+#else
+    auto codec {QTextCodec::codecForName(charset)};
+    if (codec != nullptr) {
+        // Without IgnoreHeader UTF-16/32 terms would start with a byte order mark
+        std::unique_ptr<QTextEncoder> encoder {codec->makeEncoder(QTextCodec::IgnoreHeader)};
+        return encoder->fromUnicode(text);
+    }
+#endif
+
+    return text.toUtf8();
+}
+
+TextMatcher::TextMatcher(
+    const QStringList& terms,
+    const MatchOptions& options,
+    const QByteArray& charset
+) :
+    options_ {options},
+    terms_count_ {static_cast<int>(terms.size())}
+{
+    std::vector<QByteArray> encoded_terms;
+    encoded_terms.reserve(terms.size());
+
+    for (const auto& term : terms) {
+        auto bytes {encode(term, charset)};
+        if (bytes.isEmpty()) {
+            // Same as QString::contains with an empty string
+            is_always_found_ = true;
+            continue;
+        }
+
+        if (options_.case_insensitive) {
+            for (int i = 0; i < bytes.size(); ++i) {
+                bytes[i] = static_cast<char>(foldCase(static_cast<unsigned char>(bytes[i])));
+            }
+        }
+
+        max_term_size_ = std::max<size_t>(max_term_size_, bytes.size());
+        encoded_terms.push_back(bytes);
+    }
+
+    if (encoded_terms.size() == 1 && !options_.case_insensitive && !options_.whole_word) {
+        is_literal_ = true;
+        literal_ = encoded_terms.front();
+    }
+    else {
+        Compile(encoded_terms);
+    }
+}
+
+bool TextMatcher::Feed(State& state, const char* data, size_t size) const
+{
+    if (is_always_found_) {
+        return true;
+    }
+
+    return is_literal_
+            ? FeedLiteral(state, data, size)
+            : FeedAutomaton(state, data, size);
+}
+
+bool TextMatcher::Finish(State& state) const
+{
+    auto is_found {is_always_found_ || state.is_pending};
+    state.is_pending = false;
+    return is_found;
+}
+
+quint64 TextMatcher::FindTerms(State& state, const char* data, size_t size) const
+{
+    if (is_literal_) {
+        return FeedLiteral(state, data, size) ? 1 : 0;
+    }
+
+    auto bytes {reinterpret_cast<const unsigned char*>(data)};
+    auto node {state.node};
+    quint64 terms {0};
+    for (size_t i = 0; i < size; ++i) {
+        node = transitions_[node * classes_count_ + byte_classes_[bytes[i]]];
+        terms |= output_terms_[node];
+    }
+
+    state.node = node;
+    return terms;
+}
+
+int TextMatcher::TermsCount() const
+{
+    return terms_count_;
+}
+
+// Private
+
+void TextMatcher::Compile(const std::vector<QByteArray>& terms)
+{
+    // Class 0 stands for every byte no term contains
+    byte_classes_.fill(0);
+    classes_count_ = 1;
+    for (const auto& term : terms) {
+        for (auto byte : term) {
+            auto& byte_class {byte_classes_[static_cast<unsigned char>(byte)]};
+            if (byte_class == 0) {
+                byte_class = classes_count_++;
+            }
+        }
+    }
+    if (options_.case_insensitive) {
+        for (int byte = 'A'; byte <= 'Z'; ++byte) {
+            byte_classes_[byte] = byte_classes_[foldCase(byte)];
+        }
+    }
+
+    // Trie
+    transitions_.assign(classes_count_, NO_TRANSITION);
+    std::vector<std::vector<uint>> outputs(1);
+    output_terms_.assign(1, 0);
+
+    for (size_t term_index = 0; term_index < terms.size(); ++term_index) {
+        const auto& term {terms[term_index]};
+        uint node {0};
+        for (auto byte : term) {
+            auto index {node * classes_count_ + byte_classes_[static_cast<unsigned char>(byte)]};
+            if (transitions_[index] == NO_TRANSITION) {
+                transitions_[index] = static_cast<uint>(outputs.size());
+                transitions_.resize(transitions_.size() + classes_count_, NO_TRANSITION);
+                outputs.emplace_back();
+                output_terms_.push_back(0);
+            }
+            node = transitions_[index];
+        }
+        outputs[node].push_back(static_cast<uint>(term.size()));
+        if (term_index < 64) {
+            output_terms_[node] |= 1ull << term_index;
+        }
+    }
+
+    // Breadth-first pass turns the trie into a complete automaton: missing
+    // transitions follow the failure link, outputs inherit the failure's
+    std::vector<uint> failure(outputs.size(), 0);
+    std::queue<uint> nodes;
+
+    for (uint byte_class = 0; byte_class < classes_count_; ++byte_class) {
+        auto& next {transitions_[byte_class]};
+        if (next == NO_TRANSITION) {
+            next = 0;
+        }
+        else {
+            nodes.push(next);
+        }
+    }
+
+    while (!nodes.empty()) {
+        auto node {nodes.front()};
+        nodes.pop();
+
+        const auto& inherited {outputs[failure[node]]};
+        outputs[node].insert(outputs[node].end(), inherited.begin(), inherited.end());
+        output_terms_[node] |= output_terms_[failure[node]];
+
+        for (uint byte_class = 0; byte_class < classes_count_; ++byte_class) {
+            auto& next {transitions_[node * classes_count_ + byte_class]};
+            auto fallback {transitions_[failure[node] * classes_count_ + byte_class]};
+            if (next == NO_TRANSITION) {
+                next = fallback;
+            }
+            else {
+                failure[next] = fallback;
+                nodes.push(next);
+            }
+        }
+    }
+
+    output_offsets_.assign(1, 0);
+    output_sizes_.clear();
+    for (const auto& node_outputs : outputs) {
+        output_sizes_.insert(output_sizes_.end(), node_outputs.begin(), node_outputs.end());
+        output_offsets_.push_back(static_cast<uint>(output_sizes_.size()));
+    }
+}
+
+bool TextMatcher::FeedLiteral(State& state, const char* data, size_t size) const
+{
+    auto keep {static_cast<size_t>(literal_.size()) - 1};
+
+    // Occurrences that start in the previous chunk and end in this one,
+    // looked for with the start of this chunk appended to the tail in place
+    if (!state.tail.isEmpty() && size > 0) {
+        auto tail_size {state.tail.size()};
+        state.tail.append(data, static_cast<int>(std::min(size, keep)));
+        auto is_found {FindLiteral(state.tail.constData(), state.tail.size())};
+        state.tail.resize(tail_size);
+        if (is_found) {
+            return true;
+        }
+    }
+
+    if (FindLiteral(data, size)) {
+        return true;
+    }
+
+    keepTail(state.tail, data, size, keep);
+    return false;
+}
+
+bool TextMatcher::FeedAutomaton(State& state, const char* data, size_t size) const
+{
+    auto bytes {reinterpret_cast<const unsigned char*>(data)};
+
+    if (state.is_pending && size > 0) {
+        state.is_pending = false;
+        if (!isWordByte(bytes[0])) {
+            return true;
+        }
+    }
+
+    auto node {state.node};
+    for (size_t i = 0; i < size; ++i) {
+        node = transitions_[node * classes_count_ + byte_classes_[bytes[i]]];
+
+        auto first {output_offsets_[node]};
+        auto last {output_offsets_[node + 1]};
+        if (first == last) {
+            continue;
+        }
+
+        if (!options_.whole_word) {
+            state.node = node;
+            return true;
+        }
+
+        for (auto output = first; output < last; ++output) {
+            if (!HasWordBoundaryBefore(state, data, i, output_sizes_[output])) {
+                continue;
+            }
+            if (i + 1 == size) {
+                state.is_pending = true;
+                break;
+            }
+            if (!isWordByte(bytes[i + 1])) {
+                state.node = node;
+                return true;
+            }
+        }
+    }
+
+    state.node = node;
+    if (options_.whole_word) {
+        keepTail(state.tail, data, size, max_term_size_);
+    }
+    return false;
+}
+
+bool TextMatcher::FindLiteral(const char* data, size_t size) const
+{
+    auto literal {literal_.constData()};
+    auto length {static_cast<size_t>(literal_.size())};
+    if (size < length) {
+        return false;
+    }
+    if (length == 1) {
+        return std::memchr(data, literal[0], size) != nullptr;
+    }
+
+    // Candidates must match both the first and the last byte of the literal
+    auto last_start {size - length};
+    size_t i {0};
+
+#if defined(__AVX2__)
+    const auto first_bytes {_mm256_set1_epi8(literal[0])};
+    const auto last_bytes {_mm256_set1_epi8(literal[length - 1])};
+    for (; i + 32 <= last_start + 1; i += 32) {
+        auto block_first {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i))};
+        auto block_last {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + length - 1))};
+        auto mask {static_cast<uint>(_mm256_movemask_epi8(
+                        _mm256_and_si256(_mm256_cmpeq_epi8(first_bytes, block_first),
+                                         _mm256_cmpeq_epi8(last_bytes, block_last))))};
+        while (mask != 0) {
+            auto offset {countTrailingZeros(mask)};
+            if (std::memcmp(data + i + offset + 1, literal + 1, length - 2) == 0) {
+                return true;
+            }
+            mask &= mask - 1;
+        }
+    }
+#elif defined(TEXT_MATCHER_SSE2)
+    const auto first_bytes {_mm_set1_epi8(literal[0])};
+    const auto last_bytes {_mm_set1_epi8(literal[length - 1])};
+    for (; i + 16 <= last_start + 1; i += 16) {
+        auto block_first {_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i))};
+        auto block_last {_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + length - 1))};
+        auto mask {static_cast<uint>(_mm_movemask_epi8(
+                        _mm_and_si128(_mm_cmpeq_epi8(first_bytes, block_first),
+                                      _mm_cmpeq_epi8(last_bytes, block_last))))};
+        while (mask != 0) {
+            auto offset {countTrailingZeros(mask)};
+            if (std::memcmp(data + i + offset + 1, literal + 1, length - 2) == 0) {
+                return true;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    while (i <= last_start) {
+        auto candidate {static_cast<const char*>(std::memchr(data + i, literal[0], last_start - i + 1))};
+        if (candidate == nullptr) {
+            return false;
+        }
+        i = candidate - data;
+        if (data[i + length - 1] == literal[length - 1]
+                && std::memcmp(data + i + 1, literal + 1, length - 2) == 0) {
+            return true;
+        }
+        ++i;
+    }
+
+    return false;
+}
+
+bool TextMatcher::HasWordBoundaryBefore(
+    const State& state,
+    const char* data,
+    size_t end,
+    uint term_size
+) const
+{
+    // Byte preceding the match, possibly kept from the previous chunk
+    auto before {static_cast<long long>(end) - static_cast<long long>(term_size)};
+    unsigned char byte;
+    if (before >= 0) {
+        byte = static_cast<unsigned char>(data[before]);
+    }
+    else {
+        auto index {static_cast<long long>(state.tail.size()) + before};
+        if (index < 0) {
+            return true;
+        }
+        byte = static_cast<unsigned char>(state.tail[static_cast<int>(index)]);
+    }
+
+    return !isWordByte(byte);
+}
+
+// TextMatcherCache
+
+TextMatcherCache::TextMatcherCache(const QStringList& terms, const MatchOptions& options) :
+    terms_ {terms},
+    options_ {options}
+{
+
+}
+
+std::shared_ptr<const TextMatcher> TextMatcherCache::Get(const QByteArray& charset)
+{
+    auto name {charset.trimmed().toLower()};
+    if (name.isEmpty() || name == "utf8") {
+        name = "utf-8";
+    }
+
+    QMutexLocker locker(&mutex_);
+
+    auto& matcher {matchers_[name]};
+    if (!matcher) {
+        matcher = std::make_shared<const TextMatcher>(terms_, options_, name);
+    }
+    return matcher;
+}
@@ -0,0 +1,108 @@
+#ifndef TEXTMATCHER_H
+#define TEXTMATCHER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+struct MatchOptions
+{
+    // ASCII letters only, other bytes are compared as is
+    bool case_insensitive = false;
+    // A term only matches between non-word bytes or the body's ends
+    bool whole_word = false;
+};
+
+// Set of search terms compiled for one page charset and shared read-only by
+// all workers. Terms are encoded into the charset up front and matched
+// against the raw body bytes as they stream in; the per-body position lives
+// in State, so a term split across two chunks is still found.
+//
+// A single case-sensitive term is searched with a first/last byte filter
+// (SSE2/AVX2 when the build targets them). Several terms or any option
+// compile into an Aho-Corasick automaton over byte classes.
+class TextMatcher
+{
+public:
+    struct State
+    {
+        uint        node = 0;
+        // Last bytes of the stream, for matches crossing the chunk boundary
+        QByteArray  tail {};
+        // A whole-word match ended on the last byte fed, the next byte decides
+        bool        is_pending = false;
+    };
+
+    explicit TextMatcher(
+        const QStringList& terms = QStringList(),
+        const MatchOptions& options = MatchOptions {},
+        const QByteArray& charset = "utf-8"
+    );
+
+    // Returns true once any term has been seen in the stream
+    bool Feed(State& state, const char* data, size_t size) const;
+
+    // Ends the stream, returns true for a match that needed the next byte
+    bool Finish(State& state) const;
+
+    // Scans the whole chunk and returns the terms seen in it, bit i for
+    // term i of the first 64. Ignores whole_word; a single literal term is
+    // only looked for until found.
+    quint64 FindTerms(State& state, const char* data, size_t size) const;
+
+    int TermsCount() const;
+
+private:
+
+    MatchOptions    options_;
+    int             terms_count_ = 0;
+    bool            is_always_found_ = false;
+    size_t          max_term_size_ = 0;
+
+    // Single literal
+    bool        is_literal_ = false;
+    QByteArray  literal_ {};
+
+    // Aho-Corasick automaton, transitions_[node * classes_count_ + class]
+    std::array<uint, 256>   byte_classes_ {};
+    uint                    classes_count_ = 1;
+    std::vector<uint>       transitions_ {};
+    std::vector<uint>       output_offsets_ {};
+    std::vector<uint>       output_sizes_ {};
+    std::vector<quint64>    output_terms_ {};
+
+    void Compile(const std::vector<QByteArray>& terms);
+
+    bool FeedLiteral(State& state, const char* data, size_t size) const;
+
+    bool FeedAutomaton(State& state, const char* data, size_t size) const;
+
+    bool FindLiteral(const char* data, size_t size) const;
+
+    bool HasWordBoundaryBefore(const State& state, const char* data, size_t end, uint term_size) const;
+};
+
+// Compiles the terms of a crawl once per page charset, on first use
+class TextMatcherCache
+{
+public:
+    TextMatcherCache(const QStringList& terms, const MatchOptions& options);
+
+    // An empty or unknown charset falls back to UTF-8
+    std::shared_ptr<const TextMatcher> Get(const QByteArray& charset);
+
+private:
+
+    QStringList     terms_;
+    MatchOptions    options_;
+
+    QMutex                                                  mutex_;
+    QHash<QByteArray, std::shared_ptr<const TextMatcher>>   matchers_ {};
+};
+
+#endif // TEXTMATCHER_H
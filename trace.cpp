@@ -0,0 +1,180 @@
+#include "trace.h"
+
+#include <QDebug>
+#include <QMutexLocker>
+#include <QSaveFile>
+
+#include <algorithm>
+
+static constexpr auto TRACE_PID = 1;
+
+// Ids of async spans are unique across threads
+static constexpr auto THREAD_ID_SHIFT = 40;
+
+static QByteArray toJsonString(const QString& value)
+{
+    QByteArray json {"\""};
+    for (auto c : value.toUtf8()) {
+        if (c == '"' || c == '\\') {
+            json.append('\\').append(c);
+        }
+        else if (static_cast<uchar>(c) < 0x20) {
+            json.append(QByteArray("\\u00") + QByteArray::number(static_cast<uchar>(c), 16).rightJustified(2, '0'));
+        }
+        else {
+            json.append(c);
+        }
+    }
+    return json.append('"');
+}
+
+// Trace timestamps are in µs
+static QByteArray toMicroseconds(qint64 ns)
+{
+    return QByteArray::number(ns / 1e3, 'f', 3);
+}
+
+TraceBuffer::TraceBuffer(int thread_id, const QString& thread_name, int capacity, const QElapsedTimer& clock) :
+    thread_id_ {thread_id},
+    thread_name_ {thread_name},
+    clock_ {clock},
+    events_(std::max(capacity, 1))
+{
+
+}
+
+const QElapsedTimer& TraceBuffer::Clock() const
+{
+    return clock_;
+}
+
+qint64 TraceBuffer::Now() const
+{
+    return clock_.nsecsElapsed();
+}
+
+void TraceBuffer::AddSpan(const char* name, qint64 start, qint64 end)
+{
+    Add(name, start, end, 0);
+}
+
+void TraceBuffer::AddAsyncSpan(const char* name, qint64 start, qint64 end)
+{
+    Add(name, start, end, (static_cast<quint64>(thread_id_) << THREAD_ID_SHIFT) | ++next_id_);
+}
+
+void TraceBuffer::AppendJson(QByteArray& json) const
+{
+    struct Span
+    {
+        const char* name;
+        qint64      start;
+        qint64      end;
+        quint64     id;
+    };
+
+    auto capacity {static_cast<quint64>(events_.size())};
+    auto head {head_.load(std::memory_order_acquire)};
+    auto first {head > capacity ? head - capacity : 0};
+
+    std::vector<Span> spans;
+    spans.reserve(head - first);
+    for (auto index = first; index < head; ++index) {
+        const auto& event {events_[index % capacity]};
+        spans.push_back({event.name.load(std::memory_order_relaxed),
+                         event.start.load(std::memory_order_relaxed),
+                         event.end.load(std::memory_order_relaxed),
+                         event.id.load(std::memory_order_relaxed)});
+    }
+
+    // Slots the writer reached while they were copied, the one at the head
+    // included, may hold parts of newer spans
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto last_head {head_.load(std::memory_order_relaxed)};
+    auto skipped {last_head + 1 > first + capacity ? std::min(last_head + 1 - capacity - first, head - first) : 0};
+
+    auto common {[this](const char* name, const char* phase) -> QByteArray {
+        return QByteArray("{\"name\":\"") + name + "\",\"ph\":\"" + phase
+            + "\",\"pid\":" + QByteArray::number(TRACE_PID)
+            + ",\"tid\":" + QByteArray::number(thread_id_);
+    }};
+
+    json.append(common("thread_name", "M"))
+        .append(",\"args\":{\"name\":").append(toJsonString(thread_name_)).append("}},\n");
+
+    for (auto span {spans.begin() + skipped}; span != spans.end(); ++span) {
+        if (span->id == 0) {
+            json.append(common(span->name, "X"))
+                .append(",\"ts\":").append(toMicroseconds(span->start))
+                .append(",\"dur\":").append(toMicroseconds(span->end - span->start))
+                .append("},\n");
+            continue;
+        }
+
+        auto id {QByteArray("\"0x") + QByteArray::number(span->id, 16) + '"'};
+        json.append(common(span->name, "b"))
+            .append(",\"cat\":\"async\",\"id\":").append(id)
+            .append(",\"ts\":").append(toMicroseconds(span->start))
+            .append("},\n");
+        json.append(common(span->name, "e"))
+            .append(",\"cat\":\"async\",\"id\":").append(id)
+            .append(",\"ts\":").append(toMicroseconds(span->end))
+            .append("},\n");
+    }
+}
+
+// Private
+
+void TraceBuffer::Add(const char* name, qint64 start, qint64 end, quint64 id)
+{
+    auto head {head_.load(std::memory_order_relaxed)};
+    auto& event {events_[head % events_.size()]};
+    // A reader that sees any of the stores below sees this head too
+    std::atomic_thread_fence(std::memory_order_release);
+    event.name.store(name, std::memory_order_relaxed);
+    event.start.store(start, std::memory_order_relaxed);
+    event.end.store(end, std::memory_order_relaxed);
+    event.id.store(id, std::memory_order_relaxed);
+    head_.store(head + 1, std::memory_order_release);
+}
+
+Tracer::Tracer(const TraceOptions& options) :
+    options_ {options}
+{
+    clock_.start();
+}
+
+std::shared_ptr<TraceBuffer> Tracer::AddThread(const QString& name)
+{
+    QMutexLocker locker(&mutex_);
+    auto buffer {std::make_shared<TraceBuffer>(static_cast<int>(buffers_.size()) + 1, name,
+                                               options_.events_per_thread, clock_)};
+    buffers_.push_back(buffer);
+    return buffer;
+}
+
+bool Tracer::Write() const
+{
+    if (options_.file.isEmpty()) {
+        return false;
+    }
+
+    QByteArray json {"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"};
+    {
+        QMutexLocker locker(&mutex_);
+        for (const auto& buffer : buffers_) {
+            buffer->AppendJson(json);
+        }
+    }
+    json.append("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":")
+        .append(QByteArray::number(TRACE_PID))
+        .append(",\"args\":{\"name\":\"WebCrawler\"}}\n]}\n");
+
+    QSaveFile file {options_.file};
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Trace: cannot write" << options_.file;
+        return false;
+    }
+    file.write(json);
+    return file.commit();
+}
@@ -0,0 +1,87 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+struct TraceOptions
+{
+    // Chrome trace_event JSON written when the crawl stops, empty disables tracing
+    QString file {};
+    // Newest spans kept per thread, older ones are overwritten
+    int     events_per_thread = 64 * 1024;
+};
+
+// Spans of one thread in a ring buffer. Only the owner thread adds spans, so
+// adding takes no lock: the slot is written, then the head is published.
+// A reader copies the slots behind the head and drops the ones the writer
+// may have overwritten meanwhile.
+class TraceBuffer
+{
+public:
+    TraceBuffer(int thread_id, const QString& thread_name, int capacity, const QElapsedTimer& clock);
+
+    // Started once for every buffer of a trace, spans are in its ns
+    const QElapsedTimer& Clock() const;
+
+    qint64 Now() const;
+
+    // Span nested in the spans of the thread around it
+    void AddSpan(const char* name, qint64 start, qint64 end);
+
+    // Span free to overlap the others of the thread, like a fetch among
+    // the concurrent requests of a worker
+    void AddAsyncSpan(const char* name, qint64 start, qint64 end);
+
+    // Appends the spans as trace events, each followed by a comma
+    void AppendJson(QByteArray& json) const;
+
+private:
+
+    // Relaxed atomics, a plain store on common targets
+    struct Event
+    {
+        std::atomic<const char*>    name {nullptr};
+        std::atomic<qint64>         start {0};
+        std::atomic<qint64>         end {0};
+        // 0 for a nested span
+        std::atomic<quint64>        id {0};
+    };
+
+    int                 thread_id_;
+    QString             thread_name_;
+    QElapsedTimer       clock_;
+    std::vector<Event>  events_;
+    std::atomic<quint64> head_ {0};
+    quint64             next_id_ = 0;
+
+    void Add(const char* name, qint64 start, qint64 end, quint64 id);
+};
+
+// Timeline of the worker threads of a crawl, viewable in Perfetto or chrome://tracing
+class Tracer
+{
+public:
+    explicit Tracer(const TraceOptions& options);
+
+    std::shared_ptr<TraceBuffer> AddThread(const QString& name);
+
+    // Workers may keep running, the spans they overwrite meanwhile are left out
+    bool Write() const;
+
+private:
+
+    TraceOptions    options_;
+    QElapsedTimer   clock_ {};
+
+    mutable QMutex                              mutex_;
+    std::vector<std::shared_ptr<TraceBuffer>>   buffers_ {};
+};
+
+#endif // TRACE_H
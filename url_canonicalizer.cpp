@@ -0,0 +1,172 @@
+#include "url_canonicalizer.h"
+
+#include <QUrl>
+
+#include <algorithm>
+#include <vector>
+
+static inline int hexValue(char byte)
+{
+    if (byte >= '0' && byte <= '9') {
+        return byte - '0';
+    }
+    if (byte >= 'a' && byte <= 'f') {
+        return byte - 'a' + 10;
+    }
+    if (byte >= 'A' && byte <= 'F') {
+        return byte - 'A' + 10;
+    }
+    return -1;
+}
+
+// RFC 3986 unreserved characters, equivalent whether escaped or not
+static inline bool isUnreserved(char byte)
+{
+    return (byte >= 'a' && byte <= 'z') || (byte >= 'A' && byte <= 'Z') || (byte >= '0' && byte <= '9')
+            || byte == '-' || byte == '.' || byte == '_' || byte == '~';
+}
+
+static QByteArray normalizeEscapes(const QByteArray& text)
+{
+    static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+    QByteArray normalized;
+    normalized.reserve(text.size());
+
+    for (int i = 0; i < text.size(); ++i) {
+        if (text[i] != '%' || i + 2 >= text.size()) {
+            normalized.append(text[i]);
+            continue;
+        }
+
+        auto high {hexValue(text[i + 1])};
+        auto low {hexValue(text[i + 2])};
+        if (high < 0 || low < 0) {
+            normalized.append(text[i]);
+            continue;
+        }
+
+        auto byte {static_cast<char>(high * 16 + low)};
+        if (isUnreserved(byte)) {
+            normalized.append(byte);
+        }
+        else {
+            normalized.append('%').append(HEX_DIGITS[high]).append(HEX_DIGITS[low]);
+        }
+        i += 2;
+    }
+
+    return normalized;
+}
+
+UrlCanonicalizer::UrlCanonicalizer(const CanonicalOptions& options) :
+    options_ {options}
+{
+
+}
+
+QString UrlCanonicalizer::Canonicalize(const QString& url) const
+{
+    if (!options_.enabled) {
+        return url;
+    }
+
+    auto parsed {QUrl(url).adjusted(QUrl::RemoveFragment | QUrl::NormalizePathSegments)};
+    if (!parsed.isValid() || parsed.host().isEmpty()) {
+        return url;
+    }
+
+    auto scheme {parsed.scheme().toLower()};
+    auto host {parsed.host(QUrl::FullyEncoded).toLower()};
+    if (options_.strip_www && host.startsWith("www.")) {
+        host = host.mid(4);
+    }
+
+    auto port {parsed.port()};
+    if ((scheme == "http" && port == 80) || (scheme == "https" && port == 443)) {
+        port = -1;
+    }
+
+    auto path {normalizeEscapes(parsed.path(QUrl::FullyEncoded).toLatin1())};
+    if (path.isEmpty()) {
+        path = "/";
+    }
+    else if (options_.strip_trailing_slash && path.size() > 1 && path.endsWith('/')) {
+        path.chop(1);
+    }
+
+    QByteArray canonical;
+    canonical.append(scheme.toLatin1()).append("://");
+    auto user_info {parsed.userInfo(QUrl::FullyEncoded)};
+    if (!user_info.isEmpty()) {
+        canonical.append(user_info.toLatin1()).append('@');
+    }
+    // IPv6 addresses come without their brackets
+    if (host.contains(':')) {
+        canonical.append('[').append(host.toLatin1()).append(']');
+    }
+    else {
+        canonical.append(host.toLatin1());
+    }
+    if (port >= 0) {
+        canonical.append(':').append(QByteArray::number(port));
+    }
+    canonical.append(path);
+
+    if (parsed.hasQuery()) {
+        auto query {CanonicalQuery(parsed.query(QUrl::FullyEncoded).toLatin1())};
+        if (!query.isEmpty()) {
+            canonical.append('?').append(query);
+        }
+    }
+
+    return QString::fromLatin1(canonical);
+}
+
+// Private
+
+QByteArray UrlCanonicalizer::CanonicalQuery(const QByteArray& query) const
+{
+    if (options_.query == QueryRule::kStrip) {
+        return QByteArray();
+    }
+
+    std::vector<QByteArray> params;
+    for (const auto& param : query.split('&')) {
+        if (param.isEmpty() || IsStrippedParam(param.left(param.indexOf('=')))) {
+            continue;
+        }
+        params.push_back(normalizeEscapes(param));
+    }
+
+    // Equal names keep their order, some sites read repeated parameters as a list
+    if (options_.query == QueryRule::kSort) {
+        std::stable_sort(params.begin(), params.end(), [](const QByteArray& left, const QByteArray& right) {
+            return left.left(left.indexOf('=')) < right.left(right.indexOf('='));
+        });
+    }
+
+    QByteArray canonical;
+    for (const auto& param : params) {
+        if (!canonical.isEmpty()) {
+            canonical.append('&');
+        }
+        canonical.append(param);
+    }
+    return canonical;
+}
+
+bool UrlCanonicalizer::IsStrippedParam(const QByteArray& name) const
+{
+    if (options_.strip_params.isEmpty()) {
+        return false;
+    }
+
+    auto decoded {QString::fromUtf8(QByteArray::fromPercentEncoding(name))};
+    for (const auto& pattern : options_.strip_params) {
+        if (pattern.endsWith('*') ? decoded.startsWith(pattern.left(pattern.size() - 1)) : decoded == pattern) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,62 @@
+#ifndef URLCANONICALIZER_H
+#define URLCANONICALIZER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+enum class QueryRule
+{
+    kKeep,
+    // Parameters in name order, so ?b=1&a=2 and ?a=2&b=1 are one url
+    kSort,
+    // No query at all, for sites where it never selects content
+    kStrip
+};
+
+struct CanonicalOptions
+{
+    // Off leaves the urls exactly as found
+    bool        enabled = true;
+    QueryRule   query = QueryRule::kKeep;
+    // Parameter names dropped from every query, a trailing * matches a prefix (utm_*)
+    QStringList strip_params {};
+    // Treats www.host and host as one host
+    bool        strip_www = false;
+    // Treats /a/ and /a as one path, except for the root
+    bool        strip_trailing_slash = false;
+};
+
+struct CanonicalStats
+{
+    // Urls spelled differently from their canonical form
+    quint64 rewritten = 0;
+    // Spellings of rewritten urls first pushed after their canonical form
+    // was admitted, each one a fetch avoided. Not counted with the bloom
+    // seen set, which cannot tell them from its false positives.
+    quint64 duplicates = 0;
+};
+
+// Rewrites urls into one spelling before they are checked against the seen
+// set: lower case scheme and host, no default port, no fragment, dot
+// segments resolved, percent escapes of unreserved characters decoded and
+// the others in upper case. The options add rewrites that are only safe on
+// some sites.
+class UrlCanonicalizer
+{
+public:
+    explicit UrlCanonicalizer(const CanonicalOptions& options = CanonicalOptions {});
+
+    // Urls that cannot be parsed, or have no host, are returned unchanged
+    QString Canonicalize(const QString& url) const;
+
+private:
+
+    CanonicalOptions    options_;
+
+    QByteArray CanonicalQuery(const QByteArray& query) const;
+
+    bool IsStrippedParam(const QByteArray& name) const;
+};
+
+#endif // URLCANONICALIZER_H
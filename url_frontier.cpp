@@ -0,0 +1,309 @@
+#include "url_frontier.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <limits>
+
+#include "cluster_protocol.h"
+
+UrlFrontier::UrlFrontier() = default;
+
+bool UrlFrontier::Open(
+    uint max_urls,
+    ushort workers_count,
+    const FrontierOptions& options,
+    std::function<void(int, const QString&, const UrlHint&)> Forward
+)
+{
+    store_.Close();
+
+    scheduler_ = UrlScheduler::Create(options.scheduler, options.crawl_order, workers_count,
+                                       options.politeness, options.priority);
+    checked_urls_.Reset(max_urls, options.seen_set, options.bloom_false_positive_rate);
+    rewritten_spellings_.Reset(max_urls);
+    is_seen_set_exact_ = options.seen_set == SeenSetMode::kFingerprint;
+    canonicalizer_ = UrlCanonicalizer(options.canonical);
+    partition_ = options.partition;
+    partitions_ = Forward ? std::max(options.partitions, 1) : 1;
+    Forward_ = Forward;
+    // Each of the other nodes admits max_urls at most
+    auto max_forwarded {std::min<quint64>(static_cast<quint64>(max_urls) * (partitions_ - 1),
+                                          std::numeric_limits<uint>::max())};
+    forwarded_urls_.Reset(static_cast<uint>(max_forwarded), options.seen_set, options.bloom_false_positive_rate);
+    suppressed_forwards_ = 0;
+    rewritten_urls_ = 0;
+    duplicate_urls_ = 0;
+    in_flight_.clear();
+
+    is_persistent_ = false;
+    bool is_opened {true};
+
+    if (!options.state_dir.isEmpty()) {
+        if (options.resume && !Restore(options.state_dir)) {
+            // Left as it is rather than overwritten by an empty frontier
+            qWarning() << "Url frontier: cannot resume from" << options.state_dir;
+            is_opened = false;
+        }
+        else {
+            is_persistent_ = store_.Open(options.state_dir, options.checkpoint_interval, [this]() {
+                return TakeSnapshot();
+            });
+            is_opened = is_persistent_;
+        }
+    }
+
+    is_paused_ = false;
+    is_stopped_ = false;
+    return is_opened;
+}
+
+bool UrlFrontier::Push(const QString& url, int worker, const UrlHint& hint)
+{
+    if (is_stopped_) {
+        return false;
+    }
+
+    auto canonical {canonicalizer_.Canonicalize(url)};
+    auto is_rewritten {canonical != url};
+    if (is_rewritten) {
+        ++rewritten_urls_;
+    }
+
+    if (partitions_ > 1) {
+        auto partition {HostPartition(canonical, partitions_)};
+        if (partition != partition_) {
+            // The owning node would turn a url sent again away, a full set cannot tell
+            if (forwarded_urls_.Insert(canonical) || forwarded_urls_.IsFull()) {
+                Forward_(partition, canonical, hint);
+            }
+            else {
+                ++suppressed_forwards_;
+            }
+            return false;
+        }
+    }
+
+    // Only a spelling met for the first time can avoid a fetch
+    auto is_new_spelling {is_rewritten && rewritten_spellings_.Insert(url)};
+
+    bool is_admitted {false};
+    if (is_persistent_) {
+        QReadLocker locker(&store_lock_);
+        is_admitted = Admit(canonical, worker, hint);
+        if (is_admitted) {
+            store_.Append(FrontierRecord::kAdmitted, canonical);
+        }
+    }
+    else {
+        is_admitted = Admit(canonical, worker, hint);
+    }
+
+    if (!is_admitted) {
+        // A full set turns every url away, a bloom filter unseen ones too
+        if (is_new_spelling && is_seen_set_exact_ && !checked_urls_.IsFull()) {
+            ++duplicate_urls_;
+        }
+        return false;
+    }
+
+    // Pairs with the increment in Pop: either the parked worker sees
+    // the new url or we see the parked worker and wake it
+    if (parked_count_ > 0) {
+        QMutexLocker locker(&park_mutex_);
+        state_changed_.wakeOne();
+    }
+    return true;
+}
+
+QString UrlFrontier::Pop(int worker, bool wait)
+{
+    QString url;
+
+    while (!is_stopped_) {
+        if (!is_paused_ && TryPop(url, worker)) {
+            return url;
+        }
+
+        if (!wait) {
+            break;
+        }
+
+        QMutexLocker locker(&park_mutex_);
+        ++parked_count_;
+        auto ready_in {is_paused_ ? -1 : scheduler_->ReadyIn(worker)};
+        if (!is_stopped_ && ready_in > 0) {
+            // A host is waiting out its crawl delay
+            state_changed_.wait(&park_mutex_, ready_in);
+        }
+        else if (!is_stopped_ && ready_in < 0) {
+            state_changed_.wait(&park_mutex_);
+        }
+        --parked_count_;
+    }
+
+    return nullptr;
+}
+
+void UrlFrontier::Complete(const QString& url)
+{
+    if (!scheduler_) {
+        return;
+    }
+
+    if (is_persistent_) {
+        QReadLocker locker(&store_lock_);
+        {
+            QMutexLocker in_flight_locker(&in_flight_mutex_);
+            in_flight_.remove(url);
+        }
+        scheduler_->Complete(url);
+        store_.Append(FrontierRecord::kCompleted, url);
+    }
+    else {
+        scheduler_->Complete(url);
+    }
+
+    // The released host may be ready for any parked worker
+    if (parked_count_ > 0) {
+        WakeAll();
+    }
+}
+
+void UrlFrontier::Pause()
+{
+    is_paused_ = true;
+
+    // A paused crawl is the one most likely to be resumed later
+    if (is_persistent_) {
+        store_.RequestCheckpoint();
+    }
+}
+
+void UrlFrontier::Resume()
+{
+    is_paused_ = false;
+    WakeAll();
+}
+
+void UrlFrontier::Stop()
+{
+    is_stopped_ = true;
+    WakeAll();
+
+    // The last checkpoint keeps the urls still queued or in flight
+    store_.Close();
+}
+
+void UrlFrontier::Clear()
+{
+    if (scheduler_) {
+        scheduler_->Clear();
+    }
+    checked_urls_.Clear();
+    rewritten_spellings_.Clear();
+    forwarded_urls_.Clear();
+
+    QMutexLocker in_flight_locker(&in_flight_mutex_);
+    in_flight_.clear();
+}
+
+bool UrlFrontier::IsEmpty() const
+{
+    return !scheduler_ || scheduler_->IsEmpty();
+}
+
+long UrlFrontier::Size() const
+{
+    return scheduler_ ? scheduler_->Size() : 0;
+}
+
+double UrlFrontier::SeenBytesPerUrl() const
+{
+    return checked_urls_.BytesPerUrl();
+}
+
+CanonicalStats UrlFrontier::GetCanonicalStats() const
+{
+    CanonicalStats stats;
+    stats.rewritten = rewritten_urls_;
+    stats.duplicates = duplicate_urls_;
+    return stats;
+}
+
+quint64 UrlFrontier::GetSuppressedForwards() const
+{
+    return suppressed_forwards_;
+}
+
+// Private
+
+void UrlFrontier::WakeAll()
+{
+    QMutexLocker locker(&park_mutex_);
+    state_changed_.wakeAll();
+}
+
+bool UrlFrontier::Admit(const QString& url, int worker, const UrlHint& hint)
+{
+    if (!checked_urls_.Insert(url)) {
+        return false;
+    }
+
+    scheduler_->Push(url, worker, hint);
+    return true;
+}
+
+bool UrlFrontier::TryPop(QString& url, int worker)
+{
+    if (!is_persistent_) {
+        return scheduler_->TryPop(url, worker);
+    }
+
+    // Popped urls stay in the checkpoints until their fetch completes
+    QReadLocker locker(&store_lock_);
+    if (!scheduler_->TryPop(url, worker)) {
+        return false;
+    }
+
+    QMutexLocker in_flight_locker(&in_flight_mutex_);
+    in_flight_.insert(url);
+    return true;
+}
+
+bool UrlFrontier::Restore(const QString& dir)
+{
+    FrontierSnapshot snapshot;
+    QStringList admitted;
+    if (!FrontierStore::Load(dir, snapshot, admitted) || !checked_urls_.Load(snapshot.seen)) {
+        return false;
+    }
+
+    for (const auto& url : admitted) {
+        checked_urls_.Insert(url);
+    }
+    for (const auto& url : snapshot.pending) {
+        scheduler_->Push(url, -1, UrlHint {});
+    }
+
+    return true;
+}
+
+FrontierSnapshot UrlFrontier::TakeSnapshot()
+{
+    QWriteLocker locker(&store_lock_);
+
+    FrontierSnapshot snapshot;
+    snapshot.seen = checked_urls_.Save();
+
+    // Urls fetched when the crawl stopped go first, they were popped earliest
+    {
+        QMutexLocker in_flight_locker(&in_flight_mutex_);
+        for (const auto& url : in_flight_) {
+            snapshot.pending.append(url);
+        }
+    }
+    snapshot.pending.append(scheduler_->Snapshot());
+
+    return snapshot;
+}
@@ -0,0 +1,142 @@
+#ifndef URLFRONTIER_H
+#define URLFRONTIER_H
+
+#include <QString>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include "frontier_store.h"
+#include "seen_url_set.h"
+#include "url_canonicalizer.h"
+#include "url_scheduler.h"
+
+struct FrontierOptions
+{
+    SchedulerMode   scheduler = SchedulerMode::kSharedQueue;
+    // Honoured by the work-stealing scheduler, the shared queue is always breadth-first
+    CrawlOrder      crawl_order = CrawlOrder::kBreadthFirst;
+    // Honoured by the host politeness scheduler
+    PolitenessOptions politeness {};
+    // Honoured by the best-first scheduler
+    PriorityOptions priority {};
+
+    // Applied to every url before the seen set
+    CanonicalOptions canonical {};
+
+    // Share of the hosts crawled by this process, by HostPartition of
+    // the canonical url. Urls of the other partitions are forwarded.
+    int             partition = 0;
+    int             partitions = 1;
+
+    SeenSetMode     seen_set = SeenSetMode::kFingerprint;
+    double          bloom_false_positive_rate = 0.001;
+
+    // Directory persisting the frontier, empty to keep it in memory only
+    QString         state_dir {};
+    // Continue from the frontier persisted in state_dir instead of starting over
+    bool            resume = false;
+    int             checkpoint_interval = 60000; // ms
+};
+
+class UrlFrontier
+{
+public:
+    UrlFrontier();
+
+    // Returns false when the persisted frontier could not be restored or
+    // stored, the frontier then starts empty or stays in memory only.
+    // Forward takes the urls of the other partitions, with their partition.
+    bool Open(
+        uint max_urls,
+        ushort workers_count,
+        const FrontierOptions& options,
+        std::function<void(int, const QString&, const UrlHint&)> Forward = nullptr
+    );
+
+    // The url is admitted in its canonical form, worker is the index of
+    // the pushing worker, -1 from outside the workers. A url of another
+    // partition is forwarded and not admitted.
+    bool Push(const QString& url, int worker = -1, const UrlHint& hint = UrlHint {});
+
+    // Returns nullptr when no url is available. With wait set the call
+    // parks the thread until a url is pushed or the frontier is stopped.
+    QString Pop(int worker, bool wait);
+
+    // Releases the host of a popped url once its fetch has ended
+    void Complete(const QString& url);
+
+    void Pause();
+
+    void Resume();
+
+    void Stop();
+
+    void Clear();
+
+    bool IsEmpty() const;
+
+    long Size() const;
+
+    double SeenBytesPerUrl() const;
+
+    CanonicalStats GetCanonicalStats() const;
+
+    // Urls of the other partitions not forwarded, as they were forwarded before
+    quint64 GetSuppressedForwards() const;
+
+private:
+
+    std::unique_ptr<UrlScheduler>   scheduler_ {};
+    SeenUrlSet                      checked_urls_ {};
+    UrlCanonicalizer                canonicalizer_ {};
+    int                             partition_ = 0;
+    int                             partitions_ = 1;
+
+    std::function<void(int, const QString&, const UrlHint&)> Forward_ {};
+    // Canonical urls already forwarded to the other partitions, kept in
+    // the same mode as the seen set
+    SeenUrlSet              forwarded_urls_ {};
+    std::atomic<quint64>    suppressed_forwards_ {0};
+
+    std::atomic<quint64>    rewritten_urls_ {0};
+    std::atomic<quint64>    duplicate_urls_ {0};
+    // Raw spellings of the rewritten urls pushed so far, a spelling
+    // pushed again is not another duplicate
+    SeenUrlSet              rewritten_spellings_ {};
+    // Off with a bloom filter, whose false positives are not duplicates
+    bool                    is_seen_set_exact_ = true;
+
+    // Set by Open when state_dir is given, mutations then hold
+    // store_lock_ for reading so a checkpoint sees a consistent frontier
+    bool                is_persistent_ = false;
+    FrontierStore       store_ {};
+    QReadWriteLock      store_lock_;
+    QMutex              in_flight_mutex_;
+    QSet<QString>       in_flight_ {};
+
+    std::atomic<bool>   is_paused_ {false};
+    std::atomic<bool>   is_stopped_ {true};
+    std::atomic<int>    parked_count_ {0};
+
+    // Only taken to park and wake idle workers, never on the push/pop fast path
+    QMutex          park_mutex_;
+    QWaitCondition  state_changed_;
+
+    void WakeAll();
+
+    bool Admit(const QString& url, int worker, const UrlHint& hint);
+
+    bool TryPop(QString& url, int worker);
+
+    bool Restore(const QString& dir);
+
+    FrontierSnapshot TakeSnapshot();
+};
+
+#endif // URLFRONTIER_H
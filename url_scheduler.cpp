@@ -0,0 +1,474 @@
+#include "url_scheduler.h"
+
+#include <QUrl>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <random>
+
+static constexpr auto STEAL_BATCH_MAX = 32;
+
+std::unique_ptr<UrlScheduler> UrlScheduler::Create(
+    SchedulerMode mode,
+    CrawlOrder order,
+    ushort workers_count,
+    const PolitenessOptions& politeness,
+    const PriorityOptions& priority
+)
+{
+    switch (mode) {
+    case SchedulerMode::kWorkStealing:
+        return std::unique_ptr<UrlScheduler> {new WorkStealingScheduler(order, workers_count)};
+    case SchedulerMode::kHostPoliteness:
+        return std::unique_ptr<UrlScheduler> {new HostPolitenessScheduler(order, workers_count, politeness)};
+    case SchedulerMode::kBestFirst:
+        return std::unique_ptr<UrlScheduler> {new BestFirstScheduler(priority)};
+    case SchedulerMode::kSharedQueue:
+    default:
+        return std::unique_ptr<UrlScheduler> {new SharedQueueScheduler()};
+    }
+}
+
+// SharedQueueScheduler
+
+void SharedQueueScheduler::Push(const QString& url, int, const UrlHint&)
+{
+    urls_queue_.Push(url);
+}
+
+bool SharedQueueScheduler::TryPop(QString& url, int)
+{
+    return urls_queue_.TryPop(url);
+}
+
+bool SharedQueueScheduler::IsEmpty() const
+{
+    return urls_queue_.IsEmpty();
+}
+
+long SharedQueueScheduler::Size() const
+{
+    return urls_queue_.Size();
+}
+
+void SharedQueueScheduler::Clear()
+{
+    urls_queue_.Clear();
+}
+
+QStringList SharedQueueScheduler::Snapshot() const
+{
+    QStringList urls;
+    for (auto& url : urls_queue_.Snapshot()) {
+        urls.append(std::move(url));
+    }
+    return urls;
+}
+
+// WorkStealingScheduler
+
+WorkStealingScheduler::WorkStealingScheduler(CrawlOrder order, ushort workers_count) :
+    order_ {order}
+{
+    queues_.reserve(std::max<ushort>(workers_count, 1));
+    for (int i = 0; i < std::max<ushort>(workers_count, 1); ++i) {
+        queues_.emplace_back(new LocalQueue {});
+    }
+}
+
+void WorkStealingScheduler::Push(const QString& url, int worker, const UrlHint&)
+{
+    // Urls from outside the workers are spread round-robin
+    auto index {worker >= 0 ? static_cast<uint>(worker) : next_queue_++};
+    auto& queue {*queues_[index % queues_.size()]};
+    {
+        QMutexLocker locker(&queue.mutex);
+        queue.urls.push_back(url);
+    }
+    ++size_;
+}
+
+bool WorkStealingScheduler::TryPop(QString& url, int worker)
+{
+    if (worker >= 0 && TryPopLocal(url, *queues_[worker % queues_.size()])) {
+        return true;
+    }
+
+    return TrySteal(url, worker);
+}
+
+bool WorkStealingScheduler::IsEmpty() const
+{
+    return size_ <= 0;
+}
+
+long WorkStealingScheduler::Size() const
+{
+    return std::max<long>(size_, 0);
+}
+
+void WorkStealingScheduler::Clear()
+{
+    for (auto& queue : queues_) {
+        QMutexLocker locker(&queue->mutex);
+        size_ -= queue->urls.size();
+        queue->urls.clear();
+    }
+}
+
+QStringList WorkStealingScheduler::Snapshot() const
+{
+    QStringList urls;
+    for (const auto& queue : queues_) {
+        QMutexLocker locker(&queue->mutex);
+        std::copy(queue->urls.begin(), queue->urls.end(), std::back_inserter(urls));
+    }
+    return urls;
+}
+
+// Private
+
+bool WorkStealingScheduler::TryPopLocal(QString& url, LocalQueue& queue)
+{
+    QMutexLocker locker(&queue.mutex);
+
+    if (queue.urls.empty()) {
+        return false;
+    }
+
+    if (order_ == CrawlOrder::kDepthFirst) {
+        url = std::move(queue.urls.back());
+        queue.urls.pop_back();
+    }
+    else {
+        url = std::move(queue.urls.front());
+        queue.urls.pop_front();
+    }
+    --size_;
+    return true;
+}
+
+bool WorkStealingScheduler::TrySteal(QString& url, int worker)
+{
+    if (size_ <= 0) {
+        return false;
+    }
+
+    thread_local std::minstd_rand random {std::random_device {}()};
+
+    auto queues_count {queues_.size()};
+    auto first_victim {random() % queues_count};
+
+    for (size_t i = 0; i < queues_count; ++i) {
+        auto victim_index {(first_victim + i) % queues_count};
+        if (worker >= 0 && victim_index == worker % queues_count) {
+            continue;
+        }
+
+        std::deque<QString> stolen;
+        {
+            auto& victim {*queues_[victim_index]};
+            QMutexLocker locker(&victim.mutex);
+
+            if (victim.urls.empty()) {
+                continue;
+            }
+
+            // Take from the end the owner does not pop
+            auto count {worker >= 0
+                        ? std::min<size_t>(std::max<size_t>(victim.urls.size() / 2, 1), STEAL_BATCH_MAX)
+                        : 1};
+            if (order_ == CrawlOrder::kDepthFirst) {
+                stolen.assign(std::make_move_iterator(victim.urls.begin()),
+                              std::make_move_iterator(victim.urls.begin() + count));
+                victim.urls.erase(victim.urls.begin(), victim.urls.begin() + count);
+            }
+            else {
+                stolen.assign(std::make_move_iterator(victim.urls.end() - count),
+                              std::make_move_iterator(victim.urls.end()));
+                victim.urls.erase(victim.urls.end() - count, victim.urls.end());
+            }
+        }
+
+        url = std::move(stolen.front());
+        stolen.pop_front();
+        --size_;
+
+        if (!stolen.empty()) {
+            auto& own {*queues_[worker % queues_count]};
+            QMutexLocker locker(&own.mutex);
+            own.urls.insert(own.urls.end(),
+                            std::make_move_iterator(stolen.begin()),
+                            std::make_move_iterator(stolen.end()));
+        }
+        return true;
+    }
+
+    return false;
+}
+
+// HostPolitenessScheduler
+
+HostPolitenessScheduler::HostPolitenessScheduler(
+    CrawlOrder order,
+    ushort workers_count,
+    const PolitenessOptions& options
+) :
+    order_ {order},
+    options_ {options},
+    ready_(std::max<ushort>(workers_count, 1))
+{
+    options_.max_requests_per_host = std::max<ushort>(options_.max_requests_per_host, 1);
+    options_.crawl_delay = std::max(options_.crawl_delay, 0);
+    clock_.start();
+}
+
+void HostPolitenessScheduler::Push(const QString& url, int, const UrlHint&)
+{
+    auto name {HostName(url)};
+    QMutexLocker locker(&mutex_);
+
+    auto hostIt {hosts_.find(name)};
+    if (hostIt == hosts_.end()) {
+        // New hosts are spread by hash, stealing evens out the load later
+        hostIt = hosts_.insert(name, Host {});
+        hostIt->owner = qHash(name) % ready_.size();
+    }
+
+    hostIt->urls.push_back(url);
+    ++size_;
+    Schedule(name, *hostIt);
+}
+
+bool HostPolitenessScheduler::TryPop(QString& url, int worker)
+{
+    QMutexLocker locker(&mutex_);
+
+    auto now {clock_.elapsed()};
+    auto own {worker >= 0 ? static_cast<size_t>(worker) % ready_.size() : 0};
+
+    for (size_t i = 0; i < ready_.size(); ++i) {
+        auto index {(own + i) % ready_.size()};
+        if (IsReady(ready_[index], index, own, now)) {
+            Take(url, ready_[index], own, now);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool HostPolitenessScheduler::IsEmpty() const
+{
+    return size_ <= 0;
+}
+
+long HostPolitenessScheduler::Size() const
+{
+    return std::max<long>(size_, 0);
+}
+
+void HostPolitenessScheduler::Clear()
+{
+    QMutexLocker locker(&mutex_);
+
+    hosts_.clear();
+    for (auto& heap : ready_) {
+        heap = ReadyHeap {};
+    }
+    size_ = 0;
+}
+
+QStringList HostPolitenessScheduler::Snapshot() const
+{
+    QMutexLocker locker(&mutex_);
+
+    QStringList urls;
+    for (const auto& host : hosts_) {
+        std::copy(host.urls.begin(), host.urls.end(), std::back_inserter(urls));
+    }
+    return urls;
+}
+
+void HostPolitenessScheduler::Complete(const QString& url)
+{
+    auto name {HostName(url)};
+    QMutexLocker locker(&mutex_);
+
+    auto hostIt {hosts_.find(name)};
+    if (hostIt == hosts_.end() || hostIt->in_flight == 0) {
+        return;
+    }
+
+    --hostIt->in_flight;
+    Schedule(name, *hostIt);
+}
+
+long HostPolitenessScheduler::ReadyIn(int worker) const
+{
+    QMutexLocker locker(&mutex_);
+
+    auto now {clock_.elapsed()};
+    auto own {worker >= 0 ? static_cast<size_t>(worker) % ready_.size() : 0};
+    long ready_in {-1};
+
+    // Mirrors TryPop: the peers' hosts count only while they could be taken over
+    for (size_t i = 0; i < ready_.size(); ++i) {
+        const auto& heap {ready_[i]};
+        if (heap.empty() || (i != own && hosts_.constFind(heap.top().name)->in_flight > 0)) {
+            continue;
+        }
+
+        auto wait {std::max<long>(heap.top().next_fetch - now, 0)};
+        ready_in = ready_in < 0 ? wait : std::min(ready_in, wait);
+    }
+
+    return ready_in;
+}
+
+// Private
+
+QString HostPolitenessScheduler::HostName(const QString& url)
+{
+    auto parsed {QUrl(url)};
+    return parsed.host() + ':' + QString::number(parsed.port(parsed.scheme() == "https" ? 443 : 80));
+}
+
+bool HostPolitenessScheduler::IsReady(const ReadyHeap& heap, size_t index, size_t worker, qint64 now) const
+{
+    if (heap.empty() || heap.top().next_fetch > now) {
+        return false;
+    }
+
+    // A peer's host moves only between fetches, so its connections are never shared
+    return index == worker || hosts_.constFind(heap.top().name)->in_flight == 0;
+}
+
+void HostPolitenessScheduler::Take(QString& url, ReadyHeap& heap, size_t worker, qint64 now)
+{
+    auto name {heap.top().name};
+    heap.pop();
+
+    auto& host {hosts_[name]};
+    host.is_ready = false;
+    host.owner = worker;
+
+    if (order_ == CrawlOrder::kDepthFirst) {
+        url = std::move(host.urls.back());
+        host.urls.pop_back();
+    }
+    else {
+        url = std::move(host.urls.front());
+        host.urls.pop_front();
+    }
+    --size_;
+
+    ++host.in_flight;
+    host.next_fetch = now + options_.crawl_delay;
+    Schedule(name, host);
+}
+
+void HostPolitenessScheduler::Schedule(const QString& name, Host& host)
+{
+    if (host.is_ready || host.urls.empty() || host.in_flight >= options_.max_requests_per_host) {
+        return;
+    }
+
+    ready_[host.owner].push(ReadyHost {host.next_fetch, name});
+    host.is_ready = true;
+}
+
+// BestFirstScheduler
+
+BestFirstScheduler::BestFirstScheduler(const PriorityOptions& options) :
+    options_ {options}
+{
+
+}
+
+void BestFirstScheduler::Push(const QString& url, int, const UrlHint& hint)
+{
+    auto host {QUrl(url).host()};
+    QMutexLocker locker(&mutex_);
+
+    ushort depth {0};
+    if (!hint.parent.isEmpty()) {
+        auto depthIt {depths_.constFind(hint.parent)};
+        depth = depthIt != depths_.constEnd() ? depthIt.value() + 1 : 1;
+    }
+
+    auto hostIt {host_urls_.find(host)};
+    if (hostIt == host_urls_.end()) {
+        hostIt = host_urls_.insert(host, 0);
+    }
+    auto score {hint.relevance
+                - options_.depth_weight * depth
+                - options_.host_weight * std::log2(1.0 + hostIt.value())};
+    ++hostIt.value();
+
+    urls_.push(Entry {score, next_order_++, depth, url, hostIt.key()});
+    ++size_;
+}
+
+bool BestFirstScheduler::TryPop(QString& url, int)
+{
+    QMutexLocker locker(&mutex_);
+
+    if (urls_.empty()) {
+        return false;
+    }
+
+    // The heap hands out const references, the url is copied before the pop
+    const auto& top {urls_.top()};
+    url = top.url;
+    depths_.insert(url, top.depth);
+
+    auto hostIt {host_urls_.find(top.host)};
+    if (hostIt != host_urls_.end() && --hostIt.value() == 0) {
+        host_urls_.erase(hostIt);
+    }
+    urls_.pop();
+    --size_;
+    return true;
+}
+
+bool BestFirstScheduler::IsEmpty() const
+{
+    return size_ <= 0;
+}
+
+long BestFirstScheduler::Size() const
+{
+    return std::max<long>(size_, 0);
+}
+
+void BestFirstScheduler::Clear()
+{
+    QMutexLocker locker(&mutex_);
+
+    urls_ = std::priority_queue<Entry> {};
+    depths_.clear();
+    host_urls_.clear();
+    size_ = 0;
+}
+
+QStringList BestFirstScheduler::Snapshot() const
+{
+    QMutexLocker locker(&mutex_);
+
+    // Best first, so a resumed crawl starts from the most promising urls
+    auto urls_heap {urls_};
+    QStringList urls;
+    while (!urls_heap.empty()) {
+        urls.append(urls_heap.top().url);
+        urls_heap.pop();
+    }
+    return urls;
+}
+
+void BestFirstScheduler::Complete(const QString& url)
+{
+    QMutexLocker locker(&mutex_);
+    depths_.remove(url);
+}
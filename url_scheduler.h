@@ -0,0 +1,274 @@
+#ifndef URLSCHEDULER_H
+#define URLSCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QMutex>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <vector>
+
+#include "concurrent_queue.h"
+#include "url_scorer.h"
+
+enum class SchedulerMode
+{
+    kSharedQueue,
+    kWorkStealing,
+    kHostPoliteness,
+    kBestFirst
+};
+
+enum class CrawlOrder
+{
+    kBreadthFirst,
+    kDepthFirst
+};
+
+struct PolitenessOptions
+{
+    ushort  max_requests_per_host = 2;
+    // Minimum time between the starts of two fetches from one host
+    int     crawl_delay = 200; // ms
+};
+
+// Decides which admitted url a worker fetches next. Implementations are
+// called concurrently from every worker; worker is the caller's index,
+// or -1 for urls pushed from outside the workers (the start url).
+class UrlScheduler
+{
+public:
+    virtual ~UrlScheduler() = default;
+
+    // Only the best-first scheduler reads the hint
+    virtual void Push(const QString& url, int worker, const UrlHint& hint) = 0;
+
+    virtual bool TryPop(QString& url, int worker) = 0;
+
+    virtual bool IsEmpty() const = 0;
+
+    // Urls queued, read concurrently with pushes and pops so only a hint
+    virtual long Size() const = 0;
+
+    virtual void Clear() = 0;
+
+    // Queued urls in push order, pushing them again rebuilds the queues
+    virtual QStringList Snapshot() const = 0;
+
+    // Called once the fetch of a popped url has ended
+    virtual void Complete(const QString&) {}
+
+    // Milliseconds until TryPop may succeed for the worker: 0 when a url
+    // is ready now, -1 when only a push or a completion can make one ready
+    virtual long ReadyIn(int) const { return IsEmpty() ? -1 : 0; }
+
+    static std::unique_ptr<UrlScheduler> Create(
+        SchedulerMode mode,
+        CrawlOrder order,
+        ushort workers_count,
+        const PolitenessOptions& politeness = PolitenessOptions {},
+        const PriorityOptions& priority = PriorityOptions {}
+    );
+};
+
+// One FIFO shared by all workers, breadth-first crawl order
+class SharedQueueScheduler : public UrlScheduler
+{
+public:
+    void Push(const QString& url, int worker, const UrlHint& hint) override;
+
+    bool TryPop(QString& url, int worker) override;
+
+    bool IsEmpty() const override;
+
+    long Size() const override;
+
+    void Clear() override;
+
+    QStringList Snapshot() const override;
+
+private:
+
+    ConcurrentQueue<QString> urls_queue_ {};
+};
+
+// Every worker owns a deque of the links it discovered and serves itself
+// from it, LIFO for depth-first and FIFO for breadth-first order. A worker
+// with an empty deque steals half of a random peer's deque from the end
+// the owner does not use.
+class WorkStealingScheduler : public UrlScheduler
+{
+public:
+    WorkStealingScheduler(CrawlOrder order, ushort workers_count);
+
+    void Push(const QString& url, int worker, const UrlHint& hint) override;
+
+    bool TryPop(QString& url, int worker) override;
+
+    bool IsEmpty() const override;
+
+    long Size() const override;
+
+    void Clear() override;
+
+    QStringList Snapshot() const override;
+
+private:
+
+    struct LocalQueue
+    {
+        mutable QMutex      mutex;
+        std::deque<QString> urls;
+
+        // Keeps neighbouring deque locks off the same cache line
+        char padding[64];
+    };
+
+    CrawlOrder                                  order_;
+    std::vector<std::unique_ptr<LocalQueue>>    queues_;
+
+    std::atomic<long>   size_ {0};
+    std::atomic<uint>   next_queue_ {0};
+
+    bool TryPopLocal(QString& url, LocalQueue& queue);
+
+    bool TrySteal(QString& url, int worker);
+};
+
+// Keeps a queue per host. A host has at most max_requests_per_host fetches
+// in flight, started no closer than crawl_delay apart, and the hosts wait in
+// heaps ordered by the time of their next allowed fetch. Hosts are split
+// between the workers so every host stays on one worker's network manager
+// and reuses its keep-alive connections; an idle worker takes over a ready
+// host with nothing in flight from a peer.
+class HostPolitenessScheduler : public UrlScheduler
+{
+public:
+    HostPolitenessScheduler(
+        CrawlOrder order,
+        ushort workers_count,
+        const PolitenessOptions& options
+    );
+
+    void Push(const QString& url, int worker, const UrlHint& hint) override;
+
+    bool TryPop(QString& url, int worker) override;
+
+    bool IsEmpty() const override;
+
+    long Size() const override;
+
+    void Clear() override;
+
+    QStringList Snapshot() const override;
+
+    void Complete(const QString& url) override;
+
+    long ReadyIn(int worker) const override;
+
+private:
+
+    struct Host
+    {
+        std::deque<QString> urls;
+        qint64  next_fetch = 0; // ms of clock_
+        ushort  in_flight = 0;
+        size_t  owner = 0;
+        // Queued on the owner's ready heap
+        bool    is_ready = false;
+    };
+
+    struct ReadyHost
+    {
+        qint64  next_fetch;
+        QString name;
+
+        bool operator>(const ReadyHost& other) const
+        {
+            return next_fetch > other.next_fetch;
+        }
+    };
+
+    using ReadyHeap = std::priority_queue<ReadyHost, std::vector<ReadyHost>, std::greater<ReadyHost>>;
+
+    CrawlOrder          order_;
+    PolitenessOptions   options_;
+
+    // The crawl delay bounds the pop rate, so one lock does not limit throughput
+    mutable QMutex          mutex_;
+    QHash<QString, Host>    hosts_ {};
+    std::vector<ReadyHeap>  ready_;
+    QElapsedTimer           clock_ {};
+
+    std::atomic<long>   size_ {0};
+
+    static QString HostName(const QString& url);
+
+    bool IsReady(const ReadyHeap& heap, size_t index, size_t worker, qint64 now) const;
+
+    void Take(QString& url, ReadyHeap& heap, size_t worker, qint64 now);
+
+    void Schedule(const QString& name, Host& host);
+};
+
+// Pops the url with the highest score first: the relevance the worker gave
+// the link, less a penalty for its depth from the start url and one for the
+// urls already queued from its host, so a single relevant host does not
+// crowd out the others. Equal scores pop in push order, breadth-first.
+class BestFirstScheduler : public UrlScheduler
+{
+public:
+    explicit BestFirstScheduler(const PriorityOptions& options);
+
+    void Push(const QString& url, int worker, const UrlHint& hint) override;
+
+    bool TryPop(QString& url, int worker) override;
+
+    bool IsEmpty() const override;
+
+    long Size() const override;
+
+    void Clear() override;
+
+    QStringList Snapshot() const override;
+
+    void Complete(const QString& url) override;
+
+private:
+
+    struct Entry
+    {
+        double  score;
+        quint64 order;
+        ushort  depth;
+        QString url;
+        // Shares the key of host_urls_
+        QString host;
+
+        bool operator<(const Entry& other) const
+        {
+            return score < other.score || (score == other.score && order > other.order);
+        }
+    };
+
+    PriorityOptions     options_;
+
+    // Fetches take far longer than a heap operation, one lock does not limit throughput
+    mutable QMutex              mutex_;
+    std::priority_queue<Entry>  urls_ {};
+    // Popped urls until their fetch completes, for the depth of their links
+    QHash<QString, ushort>      depths_ {};
+    // Urls still queued by host, a host leaves once none is left
+    QHash<QString, uint>        host_urls_ {};
+    quint64                     next_order_ = 0;
+
+    std::atomic<long>   size_ {0};
+};
+
+#endif // URLSCHEDULER_H
@@ -0,0 +1,83 @@
+#include "url_scorer.h"
+
+#include <QtAlgorithms>
+
+#include <algorithm>
+
+static constexpr auto KEYWORD_SIZE_MIN = 3;
+static constexpr auto KEYWORDS_MAX = 64;
+
+// Words of the terms, shorter ones match too much to tell pages apart
+static QStringList splitKeywords(const QStringList& terms)
+{
+    QStringList keywords;
+
+    for (const auto& term : terms) {
+        QString word;
+        auto lower {term.toLower()};
+        for (int i = 0; i <= lower.size(); ++i) {
+            if (i < lower.size() && lower[i].isLetterOrNumber()) {
+                word.append(lower[i]);
+                continue;
+            }
+            if (word.size() >= KEYWORD_SIZE_MIN && !keywords.contains(word) && keywords.size() < KEYWORDS_MAX) {
+                keywords.append(word);
+            }
+            word.clear();
+        }
+    }
+
+    return keywords;
+}
+
+UrlScorer::UrlScorer(const QStringList& terms, const PriorityOptions& options) :
+    options_ {options},
+    keywords_ {splitKeywords(terms)},
+    matchers_ {keywords_, MatchOptions {true, false}}
+{
+    all_keywords_ = keywords_.size() >= KEYWORDS_MAX ? ~0ull : (1ull << keywords_.size()) - 1;
+}
+
+const PriorityOptions& UrlScorer::Options() const
+{
+    return options_;
+}
+
+void UrlScorer::Start(Page& page, const QByteArray& charset)
+{
+    if (!keywords_.isEmpty()) {
+        page.matcher = matchers_.Get(charset);
+    }
+}
+
+void UrlScorer::Feed(Page& page, const char* data, size_t size) const
+{
+    // Once every keyword is seen the rest of the page cannot change the score
+    if (page.matcher && page.keywords != all_keywords_) {
+        page.keywords |= page.matcher->FindTerms(page.state, data, size);
+    }
+}
+
+double UrlScorer::Relevance(const Page& page, const QString& url, const QByteArray& anchor_text) const
+{
+    if (keywords_.isEmpty()) {
+        return 0;
+    }
+
+    // Anchor text is taken as UTF-8 whatever the page charset, close enough for a hint
+    auto url_text {url.toLower()};
+    auto anchor {QString::fromUtf8(anchor_text).toLower()};
+
+    int url_hits {0};
+    int anchor_hits {0};
+    for (const auto& keyword : keywords_) {
+        url_hits += url_text.contains(keyword) ? 1 : 0;
+        anchor_hits += anchor.contains(keyword) ? 1 : 0;
+    }
+
+    auto page_share {static_cast<double>(qPopulationCount(page.keywords)) / keywords_.size()};
+
+    return options_.url_weight * url_hits
+            + options_.anchor_weight * anchor_hits
+            + options_.page_weight * page_share;
+}
@@ -0,0 +1,70 @@
+#ifndef URLSCORER_H
+#define URLSCORER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+#include <memory>
+
+#include "text_matcher.h"
+
+// Weights of the best-first scheduler's score
+struct PriorityOptions
+{
+    // Added per search keyword in the link's url and in its anchor text
+    double  url_weight = 2.0;
+    double  anchor_weight = 4.0;
+    // Times the share of the keywords seen on the linking page
+    double  page_weight = 2.0;
+    // Taken per link followed from the start url
+    double  depth_weight = 0.5;
+    // Taken per doubling of the urls already queued from the link's host
+    double  host_weight = 0.5;
+};
+
+// What the worker knew about a url when it found it
+struct UrlHint
+{
+    // UrlScorer::Relevance of the link
+    double  relevance = 0;
+    // Page the link was found on, empty for the start url
+    QString parent {};
+};
+
+// Relevance of the links of a page to the search, from signals that cost
+// no fetch: the search keywords, the terms split into words, found in the
+// link's url, in its anchor text and anywhere on the linking page
+class UrlScorer
+{
+public:
+    // Keywords seen on a page while its body streams in
+    struct Page
+    {
+        std::shared_ptr<const TextMatcher>  matcher {};
+        TextMatcher::State                  state {};
+        quint64                             keywords = 0;
+    };
+
+    UrlScorer(const QStringList& terms, const PriorityOptions& options);
+
+    const PriorityOptions& Options() const;
+
+    // Picks the keyword matcher for the page charset, before the first Feed
+    void Start(Page& page, const QByteArray& charset);
+
+    void Feed(Page& page, const char* data, size_t size) const;
+
+    double Relevance(const Page& page, const QString& url, const QByteArray& anchor_text) const;
+
+private:
+
+    PriorityOptions     options_;
+    // Lower case, at most 64
+    QStringList         keywords_ {};
+    quint64             all_keywords_ = 0;
+    // Case-insensitive, so always the automaton FindTerms needs
+    TextMatcherCache    matchers_;
+};
+
+#endif // URLSCORER_H
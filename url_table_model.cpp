@@ -0,0 +1,207 @@
+#include "url_table_model.h"
+
+#include <QBrush>
+
+#include <algorithm>
+
+static const QStringList COLUMN_HEADER = QStringList {"URL", "Status", "Result"};
+
+UrlTableModel::UrlTableModel(int recent_rows, QObject *parent) :
+    QAbstractTableModel(parent),
+    recent_rows_ {std::max(recent_rows, 0)}
+{
+
+}
+
+int UrlTableModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : shown_rows_;
+}
+
+int UrlTableModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : kColumnCount;
+}
+
+QVariant UrlTableModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= shown_rows_) {
+        return QVariant();
+    }
+
+    const auto& row {rows_[index.row()]};
+
+    switch (index.column()) {
+    case kColumnUrl:
+        if (role == Qt::DisplayRole) {
+            return row.url;
+        }
+        break;
+    case kColumnStatus:
+        if (role == Qt::CheckStateRole) {
+            return row.state;
+        }
+        break;
+    case kColumnResult:
+        if (role == Qt::DisplayRole) {
+            return row.result;
+        }
+        if (role == Qt::ForegroundRole) {
+            return QBrush(row.color);
+        }
+        break;
+    default:
+        break;
+    }
+
+    return QVariant();
+}
+
+QVariant UrlTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section >= 0 && section < kColumnCount) {
+        return COLUMN_HEADER[section];
+    }
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+void UrlTableModel::Update(
+    const QString& url,
+    Qt::CheckState state,
+    const QString& result,
+    const QColor& color,
+    bool is_kept
+)
+{
+    auto is_final {state == Qt::CheckState::Checked};
+    if (is_final) {
+        CountResult(result);
+    }
+
+    // Urls whose row left the window come back as new rows
+    auto idIt {row_ids_.constFind(url)};
+    auto row_index {idIt == row_ids_.constEnd() ? -1 : FindRow(*idIt)};
+    if (row_index < 0) {
+        row_ids_.insert(url, next_id_);
+        rows_.push_back(Row {next_id_++, url, state, result, color, is_kept});
+        if (is_final && !is_kept) {
+            ++evictable_rows_;
+        }
+        return;
+    }
+
+    auto& row {rows_[row_index]};
+    auto was_evictable {row.state == Qt::CheckState::Checked && !row.is_kept};
+    row.state = state;
+    row.result = result;
+    row.color = color;
+    row.is_kept = row.is_kept || is_kept;
+    evictable_rows_ += (is_final && !row.is_kept) - was_evictable;
+
+    // Rows not shown yet go out with their insertion
+    if (row_index < shown_rows_) {
+        changed_first_ = changed_first_ > changed_last_ ? row_index : std::min(changed_first_, row_index);
+        changed_last_ = std::max(changed_last_, row_index);
+    }
+}
+
+int UrlTableModel::Flush()
+{
+    if (changed_first_ <= changed_last_) {
+        emit dataChanged(index(changed_first_, 0), index(changed_last_, kColumnCount - 1));
+        changed_first_ = 0;
+        changed_last_ = -1;
+    }
+
+    EvictRows();
+
+    auto appended {static_cast<int>(rows_.size()) - shown_rows_};
+    if (appended > 0) {
+        beginInsertRows(QModelIndex(), shown_rows_, static_cast<int>(rows_.size()) - 1);
+        shown_rows_ = static_cast<int>(rows_.size());
+        endInsertRows();
+    }
+
+    return appended;
+}
+
+void UrlTableModel::Clear()
+{
+    beginResetModel();
+    rows_.clear();
+    shown_rows_ = 0;
+    row_ids_.clear();
+    evictable_rows_ = 0;
+    changed_first_ = 0;
+    changed_last_ = -1;
+    totals_.clear();
+    total_index_.clear();
+    endResetModel();
+}
+
+QList<QPair<QString, quint64>> UrlTableModel::Totals() const
+{
+    return totals_;
+}
+
+// Private
+
+int UrlTableModel::FindRow(quint64 id) const
+{
+    auto rowIt {std::lower_bound(rows_.begin(), rows_.end(), id, [](const Row& row, quint64 id) {
+        return row.id < id;
+    })};
+    return rowIt != rows_.end() && rowIt->id == id ? static_cast<int>(rowIt - rows_.begin()) : -1;
+}
+
+void UrlTableModel::CountResult(const QString& result)
+{
+    auto totalIt {total_index_.constFind(result)};
+    if (totalIt == total_index_.constEnd()) {
+        total_index_.insert(result, totals_.size());
+        totals_.append(qMakePair(result, quint64 {1}));
+    }
+    else {
+        ++totals_[*totalIt].second;
+    }
+}
+
+void UrlTableModel::EvictRows()
+{
+    auto excess {evictable_rows_ - recent_rows_};
+    if (excess <= 0) {
+        return;
+    }
+
+    // Oldest first, gathered in runs of adjacent rows removed at once
+    std::vector<std::pair<int, int>> runs;
+    for (int i = 0; i < shown_rows_ && excess > 0; ++i) {
+        const auto& row {rows_[i]};
+        if (row.state != Qt::CheckState::Checked || row.is_kept) {
+            continue;
+        }
+
+        if (!runs.empty() && runs.back().second == i - 1) {
+            runs.back().second = i;
+        }
+        else {
+            runs.emplace_back(i, i);
+        }
+        --excess;
+    }
+
+    // From the last run, so the indices of the runs before stay valid
+    for (auto runIt {runs.rbegin()}; runIt != runs.rend(); ++runIt) {
+        auto first {runIt->first};
+        auto last {runIt->second};
+
+        beginRemoveRows(QModelIndex(), first, last);
+        for (auto i {first}; i <= last; ++i) {
+            row_ids_.remove(rows_[i].url);
+        }
+        rows_.erase(rows_.begin() + first, rows_.begin() + last + 1);
+        shown_rows_ -= last - first + 1;
+        evictable_rows_ -= last - first + 1;
+        endRemoveRows();
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef URLTABLEMODEL_H
+#define URLTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QColor>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+
+#include <vector>
+
+// Rows of the searched urls in the order they were first seen. Update
+// only queues a change, Flush hands the queued ones to the views at once:
+// one dataChanged for the range of the changed rows, the removal of the
+// rows that fell out of the window and one rowsInserted for the new rows.
+//
+// Only the recent_rows newest rows are kept, plus the rows marked to keep
+// (errors and matches) and the urls still being fetched. Every final
+// status is still counted in Totals.
+class UrlTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column
+    {
+        kColumnUrl,
+        kColumnStatus,
+        kColumnResult,
+        kColumnCount
+    };
+
+    explicit UrlTableModel(int recent_rows = 1000, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    // A Qt::Checked state is final, the row may then leave the window unless is_kept
+    void Update(const QString& url, Qt::CheckState state, const QString& result, const QColor& color, bool is_kept = false);
+
+    // Returns the number of rows appended
+    int Flush();
+
+    void Clear();
+
+    // Urls per final result, in the order the results first appeared
+    QList<QPair<QString, quint64>> Totals() const;
+
+private:
+
+    struct Row
+    {
+        // Rows are only ever appended, so ids grow along the rows
+        quint64         id;
+        QString         url;
+        Qt::CheckState  state;
+        QString         result;
+        QColor          color;
+        bool            is_kept;
+    };
+
+    int                     recent_rows_;
+
+    // Shown rows, then the rows appended since the last flush
+    std::vector<Row>        rows_ {};
+    int                     shown_rows_ = 0;
+    quint64                 next_id_ = 0;
+    QHash<QString, quint64> row_ids_ {};
+
+    // Finished rows not marked to keep, the ones the window evicts
+    int                     evictable_rows_ = 0;
+
+    // Range of the shown rows changed since the last flush, empty when first > last
+    int changed_first_ = 0;
+    int changed_last_ = -1;
+
+    QList<QPair<QString, quint64>>  totals_ {};
+    QHash<QString, int>             total_index_ {};
+
+    int FindRow(quint64 id) const;
+
+    void CountResult(const QString& result);
+
+    void EvictRows();
+};
+
+#endif // URLTABLEMODEL_H